@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+using bench_clock = std::chrono::steady_clock;
+
+constexpr size_t FIB_N = 30;
+constexpr size_t FIB_CUTOFF = 12;
+
+constexpr size_t FOR_SIZE = 1024 * 1024;
+constexpr size_t FOR_BATCHES[] = { 1, 8, 64, 512 };
+
+constexpr size_t TREE_DEPTH = 6;
+constexpr size_t TREE_FANOUT = 6;
+
+constexpr size_t SUBMIT_COUNT = 1024 * 64;
+
+constexpr size_t WAKEUP_COUNT = 64;
+
+constexpr size_t STEAL_COUNT = 1024 * 256;
+
+struct options {
+  std::vector<size_t> workers;
+  size_t repeat = 5;
+};
+
+struct sample {
+  double min;
+  double median;
+};
+
+static sample measure(const size_t repeat, const std::function<double()> &body) {
+  std::vector<double> seconds;
+  seconds.reserve(repeat);
+  for (size_t i = 0; i < repeat; ++i) {
+    seconds.push_back(body());
+  }
+
+  std::ranges::sort(seconds);
+  return { seconds.front(), seconds[seconds.size() / 2] };
+}
+
+static double elapsed(const bench_clock::time_point since) {
+  return std::chrono::duration<double>(bench_clock::now() - since).count();
+}
+
+
+// --- workloads ---
+
+static size_t fib_serial(const size_t n) {
+  return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static size_t fib(scheduler &sch, const size_t n) {
+  if (n < FIB_CUTOFF) {
+    return fib_serial(n);
+  }
+
+  size_t a = 0;
+  const auto handle = sch.submit(job::create([&sch, &a, n](size_t) { a = fib(sch, n - 1); }, {}, nullptr));
+  const auto b = fib(sch, n - 2);
+  handle.wait();
+
+  return a + b;
+}
+
+static double run_fib(scheduler &sch) {
+  size_t result = 0;
+
+  const auto begin = bench_clock::now();
+  sch.submit(job::create([&sch, &result](size_t) { result = fib(sch, FIB_N); }, {}, nullptr)).wait();
+  const auto seconds = elapsed(begin);
+
+  if (result != fib_serial(FIB_N)) {
+    std::cerr << "fib: wrong result " << result << std::endl;
+    std::exit(1);
+  }
+  return seconds;
+}
+
+static double run_for(scheduler &sch, const size_t batch, const split_mode split) {
+  std::vector<uint32_t> data(FOR_SIZE);
+
+  const auto begin = bench_clock::now();
+  sch.submit(
+    job::create(
+      [&data](const size_t i) { data[i] = static_cast<uint32_t>(i * 2654435761u); },
+      { 0, FOR_SIZE, batch, split }, nullptr
+    )
+  ).wait();
+  return elapsed(begin);
+}
+
+static void tree(scheduler &sch, const size_t depth, job *parent) {
+  const auto node = job::create([](size_t) {}, {}, parent);
+  if (depth == 0) {
+    sch.push(node);
+    return;
+  }
+
+  std::array<job*, TREE_FANOUT> children{};
+  for (auto &child : children) {
+    child = job::create([&sch, depth, node](size_t) { tree(sch, depth - 1, node); }, {}, node);
+  }
+  for (const auto child : children) {
+    sch.push(child);
+  }
+}
+
+static double run_tree(scheduler &sch) {
+  const auto begin = bench_clock::now();
+
+  const auto root = job::create([](size_t) {}, {}, nullptr);
+  const auto handle = root->watch();
+  sch.push(job::create([&sch, root](size_t) { tree(sch, TREE_DEPTH, root); }, {}, root));
+  handle.wait();
+
+  return elapsed(begin);
+}
+
+static double run_submit(scheduler &sch, const bool batch) {
+  std::atomic_size_t counter = 0;
+
+  const auto parent = job::create([](size_t) {}, {}, nullptr);
+  const auto handle = parent->watch();
+
+  std::vector<job*> jobs;
+  jobs.reserve(SUBMIT_COUNT);
+  for (size_t i = 0; i < SUBMIT_COUNT; ++i) {
+    jobs.push_back(job::create([&counter](size_t) { counter.fetch_add(1, std::memory_order_relaxed); }, {}, parent));
+  }
+
+  const auto begin = bench_clock::now();
+  if (batch) {
+    sch.push_batch(jobs);
+  }
+  else {
+    for (const auto job : jobs) {
+      sch.push(job);
+    }
+  }
+  handle.wait();
+
+  return elapsed(begin);
+}
+
+static sample run_wakeup(scheduler &sch) {
+  std::vector<double> latencies;
+  latencies.reserve(WAKEUP_COUNT);
+
+  for (size_t i = 0; i < WAKEUP_COUNT; ++i) {
+    // let workers park
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    bench_clock::time_point started;
+    const auto begin = bench_clock::now();
+    sch.submit(job::create([&started](size_t) { started = bench_clock::now(); }, {}, nullptr)).wait();
+
+    latencies.push_back(std::chrono::duration<double>(started - begin).count());
+  }
+
+  std::ranges::sort(latencies);
+  return { latencies.front(), latencies[latencies.size() / 2] };
+}
+
+// owner drains its deque from bottom while `thieves` threads drain it from top
+static double run_steal(const size_t thieves, const bool half) {
+  chaselev<size_t> victim(STEAL_COUNT);
+  for (size_t i = 0; i < STEAL_COUNT; ++i) {
+    victim.push(i);
+  }
+
+  std::atomic_bool go = false;
+  std::atomic_size_t count = 0;
+  std::vector<std::jthread> threads;
+  for (size_t i = 0; i < thieves; ++i) {
+    threads.emplace_back([&victim, &go, &count, half] {
+      chaselev<size_t> own(64);
+      size_t local = 0;
+      while (!go.load(std::memory_order_acquire)) {
+      }
+
+      while (!victim.empty()) {
+        if (half ? victim.steal_half(own) : victim.steal()) {
+          local++;
+        }
+        while (own.take()) {
+          local++;
+        }
+      }
+      count += local;
+    });
+  }
+
+  const auto begin = bench_clock::now();
+  go.store(true, std::memory_order_release);
+
+  size_t local = 0;
+  while (victim.take()) {
+    local++;
+  }
+  count += local;
+  threads.clear();
+  const auto seconds = elapsed(begin);
+
+  if (count != STEAL_COUNT) {
+    std::cerr << "steal: lost or duplicated items, " << count << std::endl;
+    std::exit(1);
+  }
+  return seconds;
+}
+
+
+// --- report ---
+
+class report {
+  bool _first = true;
+
+public:
+  report() {
+    std::cout << "{\n"
+      << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+      << "  \"results\": [";
+  }
+
+  ~report() {
+    std::cout << "\n  ]\n}" << std::endl;
+  }
+
+  void add(
+    const std::string &workload,
+    const std::string &params,
+    const size_t workers,
+    const sample &sample,
+    const size_t ops
+  ) {
+    std::cout << (_first ? "\n" : ",\n")
+      << "    { \"workload\": \"" << workload << "\""
+      << ", \"params\": { " << params << " }"
+      << ", \"workers\": " << workers
+      << ", \"min_seconds\": " << sample.min
+      << ", \"median_seconds\": " << sample.median
+      << ", \"ops_per_second\": " << (sample.median > 0 ? static_cast<double>(ops) / sample.median : 0)
+      << " }" << std::flush;
+    _first = false;
+  }
+};
+
+static std::vector<size_t> parse_list(const char *s) {
+  std::vector<size_t> list;
+  while (*s) {
+    char *end;
+    list.push_back(std::strtoull(s, &end, 10));
+    s = *end == ',' ? end + 1 : end;
+  }
+  return list;
+}
+
+static options parse(const int argc, char **argv) {
+  options options;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--workers=", 10) == 0) {
+      options.workers = parse_list(argv[i] + 10);
+    }
+    else if (std::strncmp(argv[i], "--repeat=", 9) == 0) {
+      options.repeat = std::max<size_t>(1, std::strtoull(argv[i] + 9, nullptr, 10));
+    }
+    else {
+      std::cerr << "usage: " << argv[0] << " [--workers=1,2,4] [--repeat=5]" << std::endl;
+      std::exit(2);
+    }
+  }
+
+  if (options.workers.empty()) {
+    const size_t max = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t n = 1; n < max; n *= 2) {
+      options.workers.push_back(n);
+    }
+    options.workers.push_back(max);
+  }
+
+  return options;
+}
+
+int main(const int argc, char **argv) {
+  const auto options = parse(argc, argv);
+
+  report report;
+  for (const auto workers : options.workers) {
+    scheduler sch({ .worker_count = workers });
+    if (!sch.start()) {
+      std::cerr << "failed to start scheduler with " << workers << " workers" << std::endl;
+      return 1;
+    }
+
+    report.add(
+      "fib", "\"n\": " + std::to_string(FIB_N) + ", \"cutoff\": " + std::to_string(FIB_CUTOFF), workers,
+      measure(options.repeat, [&sch] { return run_fib(sch); }), 1
+    );
+
+    for (const auto batch : FOR_BATCHES) {
+      for (const auto split : { split_mode::eager, split_mode::lazy }) {
+        report.add(
+          "parallel_for",
+          "\"size\": " + std::to_string(FOR_SIZE) + ", \"batch\": " + std::to_string(batch)
+          + ", \"split\": \"" + (split == split_mode::eager ? "eager" : "lazy") + "\"",
+          workers,
+          measure(options.repeat, [&sch, batch, split] { return run_for(sch, batch, split); }),
+          FOR_SIZE
+        );
+      }
+    }
+
+    // root, its first child and top node; each level adds child and node jobs
+    size_t jobs = 3;
+    for (size_t i = 0, width = 1; i < TREE_DEPTH; ++i) {
+      width *= TREE_FANOUT;
+      jobs += width * 2;
+    }
+    report.add(
+      "tree", "\"depth\": " + std::to_string(TREE_DEPTH) + ", \"fanout\": " + std::to_string(TREE_FANOUT), workers,
+      measure(options.repeat, [&sch] { return run_tree(sch); }), jobs
+    );
+
+    for (const auto batch : { false, true }) {
+      report.add(
+        "submit", "\"count\": " + std::to_string(SUBMIT_COUNT) + ", \"batch\": " + (batch ? "true" : "false"),
+        workers,
+        measure(options.repeat, [&sch, batch] { return run_submit(sch, batch); }), SUBMIT_COUNT
+      );
+    }
+
+    report.add("wakeup", "\"count\": " + std::to_string(WAKEUP_COUNT), workers, run_wakeup(sch), 1);
+
+    // one-CAS-per-item `steal_half` against plain `steal`, with workers as thieves
+    for (const auto half : { false, true }) {
+      report.add(
+        "steal", "\"count\": " + std::to_string(STEAL_COUNT) + ", \"half\": " + (half ? "true" : "false"),
+        workers,
+        measure(options.repeat, [workers, half] { return run_steal(workers, half); }), STEAL_COUNT
+      );
+    }
+
+    sch.stop(false);
+  }
+
+  return 0;
+}
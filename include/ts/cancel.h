@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+
+namespace ts {
+  class cancel_source;
+
+  /**
+   * Observer of `cancel_source`; empty token is never cancelled.
+   * Source must outlive every job holding its token.
+   */
+  class cancel_token {
+    const std::atomic_bool *_flag;
+
+    friend class cancel_source;
+
+    explicit cancel_token(const std::atomic_bool *flag) noexcept : _flag(flag) {
+    }
+
+  public:
+    cancel_token() noexcept : _flag(nullptr) {
+    }
+
+    [[nodiscard]]
+    bool cancelled() const noexcept {
+      return _flag && _flag->load(std::memory_order::relaxed);
+    }
+
+    [[nodiscard]]
+    explicit operator bool() const noexcept {
+      return _flag != nullptr;
+    }
+  };
+
+  class cancel_source {
+    std::atomic_bool _flag = false;
+
+  public:
+    cancel_source() = default;
+
+    cancel_source(const cancel_source &) = delete;
+    cancel_source &operator=(const cancel_source &) = delete;
+
+    /**
+     * Requests cancellation; ranges not yet called are discarded.
+     */
+    void cancel() noexcept {
+      _flag.store(true, std::memory_order::relaxed);
+    }
+
+    [[nodiscard]]
+    bool cancelled() const noexcept {
+      return _flag.load(std::memory_order::relaxed);
+    }
+
+    [[nodiscard]]
+    cancel_token token() const noexcept {
+      return cancel_token(&_flag);
+    }
+  };
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "job.h"
+#include "queue.h"
+
+namespace ts {
+  /**
+   * Injection queues for jobs pushed from outside workers, one per priority,
+   * plus SPSC feeds that registered producers push to without contention.
+   *
+   * Feeds are drained by any worker holding its try-lock, so they stay single-consumer.
+   */
+  class injector {
+    struct feed {
+      // held by producer
+      std::atomic_flag attached = ATOMIC_FLAG_INIT;
+      // held by draining worker
+      std::atomic_flag draining = ATOMIC_FLAG_INIT;
+      spsc<job*> ring;
+
+      explicit feed(const size_t size) : ring(size) {
+      }
+    };
+
+    vyukov<job*> _queues[PRIORITY_COUNT];
+    std::vector<std::unique_ptr<feed>> _feeds;
+    // feeds ever attached; workers look at no more
+    std::atomic_size_t _used = 0;
+
+    vyukov<job*> &queue(const job *job) {
+      return _queues[static_cast<size_t>(job->priority())];
+    }
+
+  public:
+    /**
+     * @param size Capacity of each queue. Must be power of 2.
+     * @param feeds Number of producers that may be attached at once.
+     * @param feed_size Capacity of each feed. Must be power of 2.
+     */
+    explicit injector(const size_t size, const size_t feeds = 0, const size_t feed_size = 1024)
+      : _queues{vyukov<job*>(size), vyukov<job*>(size), vyukov<job*>(size)} {
+      static_assert(PRIORITY_COUNT == 3);
+
+      _feeds.reserve(feeds);
+      for (size_t i = 0; i < feeds; ++i) {
+        _feeds.emplace_back(std::make_unique<feed>(feed_size));
+      }
+    }
+
+    injector(const injector &) = delete;
+    injector &operator=(const injector &) = delete;
+
+    bool push(job *job) {
+      return queue(job).push(job);
+    }
+
+    bool blocking_push(job *job) {
+      return queue(job).blocking_push(job);
+    }
+
+    /**
+     * Pushes leading run of jobs sharing same priority in bulk.
+     *
+     * @return Number of jobs pushed.
+     */
+    size_t push_bulk(job *const *jobs, const size_t count) {
+      if (count == 0) {
+        return 0;
+      }
+
+      const auto priority = jobs[0]->priority();
+      size_t run = 1;
+      while (run < count && jobs[run]->priority() == priority) {
+        run++;
+      }
+
+      return queue(jobs[0]).push_bulk(jobs, run);
+    }
+
+    /**
+     * Claims free feed for calling thread.
+     *
+     * @return Feed index; empty if all are attached.
+     */
+    [[nodiscard]]
+    std::optional<size_t> attach() {
+      for (size_t i = 0; i < _feeds.size(); ++i) {
+        if (_feeds[i]->attached.test_and_set(std::memory_order::acquire)) {
+          continue;
+        }
+
+        auto used = _used.load(std::memory_order::relaxed);
+        while (used <= i && !_used.compare_exchange_weak(used, i + 1, std::memory_order::release)) {
+        }
+        return i;
+      }
+      return std::nullopt;
+    }
+
+    /**
+     * Releases feed; jobs left in it are still drained.
+     */
+    void detach(const size_t i) {
+      _feeds[i]->attached.clear(std::memory_order::release);
+    }
+
+    /**
+     * Pushes through feed `i`; only by thread that attached it.
+     *
+     * @return False if feed is full.
+     */
+    bool push_feed(const size_t i, job *job) {
+      return _feeds[i]->ring.push(job);
+    }
+
+    /**
+     * Takes up to `limit` jobs from first feed after `cursor` that is non-empty and not drained by another worker.
+     * First job is returned and the rest are handed to `out`; `cursor` moves past drained feed.
+     */
+    template<typename Out>
+    job *drain(size_t &cursor, const size_t limit, Out &&out) {
+      const auto used = _used.load(std::memory_order::acquire);
+      for (size_t i = 0; i < used; ++i) {
+        const auto index = (cursor + i) % used;
+        auto &feed = *_feeds[index];
+        if (feed.ring.empty() || feed.draining.test(std::memory_order::relaxed)
+          || feed.draining.test_and_set(std::memory_order::acquire)) {
+          continue;
+        }
+
+        job *first = nullptr;
+        if (const auto opt = feed.ring.pop()) {
+          first = opt.value();
+          for (size_t n = 1; n < limit; ++n) {
+            const auto next = feed.ring.pop();
+            if (!next) {
+              break;
+            }
+            out(next.value());
+          }
+        }
+        feed.draining.clear(std::memory_order::release);
+
+        if (first) {
+          cursor = index + 1;
+          return first;
+        }
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * Cheap check before `pop`; may miss job whose push is still in progress.
+     */
+    [[nodiscard]]
+    bool empty(const job_priority priority) const {
+      return _queues[static_cast<size_t>(priority)].empty();
+    }
+
+    [[nodiscard]]
+    std::optional<job*> pop(const job_priority priority) {
+      return _queues[static_cast<size_t>(priority)].pop();
+    }
+
+    /**
+     * Pops from highest non-empty level, then from feeds.
+     */
+    [[nodiscard]]
+    std::optional<job*> pop() {
+      for (auto &queue : _queues) {
+        if (const auto opt = queue.pop()) {
+          return opt;
+        }
+      }
+
+      size_t cursor = 0;
+      if (const auto job = drain(cursor, 1, [](ts::job *) {})) {
+        return job;
+      }
+      return std::nullopt;
+    }
+
+    void kill() {
+      for (auto &queue : _queues) {
+        queue.kill();
+      }
+    }
+
+    // note: ignores inner items; may leak
+    void unsafe_reset() {
+      for (auto &queue : _queues) {
+        queue.unsafe_reset();
+      }
+      for (auto &feed : _feeds) {
+        feed->ring.unsafe_reset();
+      }
+    }
+  };
+}
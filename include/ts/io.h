@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
+#include "uring.h"
+#include "worker.h"
+
+#if __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ts {
+  enum class io_op : uint8_t {
+    read,
+    write,
+    fsync,
+    openat,
+  };
+
+  /**
+   * File operation to be awaited; whole request is kept until completion.
+   */
+  struct io_request {
+    io_op op;
+    int fd;
+    std::byte *data = nullptr;
+    size_t size = 0;
+    uint64_t offset = 0;
+    // index of registered buffer that `data` lies in; -1 if none
+    int32_t buffer = -1;
+    // `openat` flags, or fsync flags
+    int flags = 0;
+    uint32_t mode = 0;
+    const char *path = nullptr;
+
+    /**
+     * Runs request on calling thread.
+     *
+     * @return Result in io_uring convention: non-negative on success, `-errno` on failure.
+     */
+    [[nodiscard]]
+    int32_t perform() const {
+      ssize_t result = -1;
+      switch (op) {
+        case io_op::read:
+          result = ::pread(fd, data, size, static_cast<off_t>(offset));
+          break;
+        case io_op::write:
+          result = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+          break;
+        case io_op::fsync:
+#ifdef TS_URING
+          result = flags & IORING_FSYNC_DATASYNC ? ::fdatasync(fd) : ::fsync(fd);
+#else
+          result = ::fsync(fd);
+#endif
+          break;
+        case io_op::openat:
+          result = ::openat(fd, path, flags, mode);
+          break;
+      }
+      return result < 0 ? -errno : static_cast<int32_t>(result);
+    }
+
+#ifdef TS_URING
+    void prepare(io_uring_sqe &sqe, const io_ring &ring) const {
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<uint64_t>(data);
+      sqe.len = static_cast<uint32_t>(size);
+      sqe.off = offset;
+
+      const auto fixed = buffer >= 0 && static_cast<size_t>(buffer) < ring.fixed();
+      switch (op) {
+        case io_op::read:
+          sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+          break;
+        case io_op::write:
+          sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+          break;
+        case io_op::fsync:
+          sqe.opcode = IORING_OP_FSYNC;
+          sqe.fsync_flags = flags;
+          break;
+        case io_op::openat:
+          sqe.opcode = IORING_OP_OPENAT;
+          sqe.addr = reinterpret_cast<uint64_t>(path);
+          sqe.len = mode;
+          sqe.open_flags = flags;
+          break;
+      }
+
+      if (fixed) {
+        sqe.buf_index = static_cast<uint16_t>(buffer);
+      }
+    }
+#endif
+  };
+
+  /**
+   * Awaitable of file operation.
+   *
+   * On worker with ring, request is queued to that worker's ring and submitted with the rest of its batch;
+   * the worker that reaps completion resumes coroutine from its local deque.
+   * Elsewhere, or if ring is full, it runs synchronously without suspending.
+   * Throws `std::system_error` on failure.
+   */
+  template<typename T>
+  class io_awaiter {
+    io_request _request;
+    io_completion _completion;
+
+  public:
+    explicit io_awaiter(const io_request &request) noexcept : _request(request) {
+    }
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(const std::coroutine_handle<> h) {
+#ifdef TS_URING
+      const auto current = worker::current();
+      if (const auto ring = current ? current->ring() : nullptr) {
+        auto sqe = ring->prepare(&_completion);
+        if (!sqe) {
+          ring->submit();
+          sqe = ring->prepare(&_completion);
+        }
+
+        if (sqe) {
+          _completion.handle = h;
+          _request.prepare(*sqe, *ring);
+          return true;
+        }
+      }
+#endif
+
+      _completion.result = _request.perform();
+      return false;
+    }
+
+    T await_resume() const {
+      if (_completion.result < 0) {
+        throw std::system_error(-_completion.result, std::system_category());
+      }
+
+      if constexpr (!std::is_void_v<T>) {
+        return static_cast<T>(_completion.result);
+      }
+    }
+  };
+
+  /**
+   * Reads up to `buffer.size()` bytes at `offset`.
+   *
+   * @return Number of bytes read; 0 at end of file.
+   */
+  [[nodiscard]]
+  inline io_awaiter<size_t> async_read(const int fd, const std::span<std::byte> buffer, const uint64_t offset) {
+    return io_awaiter<size_t>({.op = io_op::read, .fd = fd, .data = buffer.data(), .size = buffer.size(), .offset = offset});
+  }
+
+  /**
+   * Reads into part of buffer `index` registered with `scheduler::io`.
+   */
+  [[nodiscard]]
+  inline io_awaiter<size_t> async_read_fixed(
+    const int fd,
+    const size_t index,
+    const std::span<std::byte> buffer,
+    const uint64_t offset
+  ) {
+    return io_awaiter<size_t>({
+      .op = io_op::read, .fd = fd, .data = buffer.data(), .size = buffer.size(), .offset = offset,
+      .buffer = static_cast<int32_t>(index)
+    });
+  }
+
+  /**
+   * Writes up to `buffer.size()` bytes at `offset`.
+   *
+   * @return Number of bytes written.
+   */
+  [[nodiscard]]
+  inline io_awaiter<size_t> async_write(const int fd, const std::span<const std::byte> buffer, const uint64_t offset) {
+    return io_awaiter<size_t>({
+      .op = io_op::write, .fd = fd, .data = const_cast<std::byte*>(buffer.data()), .size = buffer.size(),
+      .offset = offset
+    });
+  }
+
+  /**
+   * Writes from part of buffer `index` registered with `scheduler::io`.
+   */
+  [[nodiscard]]
+  inline io_awaiter<size_t> async_write_fixed(
+    const int fd,
+    const size_t index,
+    const std::span<const std::byte> buffer,
+    const uint64_t offset
+  ) {
+    return io_awaiter<size_t>({
+      .op = io_op::write, .fd = fd, .data = const_cast<std::byte*>(buffer.data()), .size = buffer.size(),
+      .offset = offset, .buffer = static_cast<int32_t>(index)
+    });
+  }
+
+  [[nodiscard]]
+  inline io_awaiter<void> async_fsync(const int fd, const bool datasync = false) {
+#ifdef TS_URING
+    const int flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+#else
+    const int flags = 0;
+#endif
+    return io_awaiter<void>({.op = io_op::fsync, .fd = fd, .flags = flags});
+  }
+
+  /**
+   * Opens `path` relative to `dirfd`; `path` must stay alive until resumed.
+   *
+   * @return New file descriptor.
+   */
+  [[nodiscard]]
+  inline io_awaiter<int> async_openat(const int dirfd, const char *path, const int flags, const uint32_t mode = 0) {
+    return io_awaiter<int>({.op = io_op::openat, .fd = dirfd, .flags = flags, .mode = mode, .path = path});
+  }
+}
+#endif
@@ -1,51 +1,282 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "cancel.h"
 #include "queue.h"
+#include "slab.h"
 
 namespace ts {
+  enum class split_mode {
+    // halve until under batch size before calling
+    eager,
+    // call from front batch by batch; split remainder only when local deque runs dry
+    lazy,
+  };
+
+  enum class job_priority : uint8_t {
+    // latency-sensitive; workers look for it before their own deque
+    high,
+    normal,
+    // background
+    low,
+  };
+
+  constexpr size_t PRIORITY_COUNT = 3;
+
   struct job_config {
     size_t begin = 0;
     size_t end = 1;
     size_t batch_size = 8;
+    split_mode split = split_mode::eager;
+    // ranges split from job keep it
+    job_priority priority = job_priority::normal;
+    // ranges split from job keep it; children inherit parent's when they have none
+    cancel_token cancel = {};
+    // if false, job and ranges split from it stay in mailbox of worker they were placed with
+    bool stealable = true;
+  };
+
+  // callables larger than this are stored on heap, once per `job::create`
+  constexpr size_t JOB_INLINE_SIZE = 64;
+
+  class job;
+  class mailbox;
+
+  /**
+   * Completion handle of job.
+   * Completes when every index of job (including ranges split from it) has been called.
+   */
+  class handle {
+    job *_job;
+
+    friend class job;
+
+    explicit handle(job *job) noexcept : _job(job) {
+    }
+
+  public:
+    handle() noexcept : _job(nullptr) {
+    }
+
+    handle(handle &&other) noexcept : _job(std::exchange(other._job, nullptr)) {
+    }
+
+    handle &operator=(handle &&other) noexcept;
+
+    handle(const handle &) = delete;
+    handle &operator=(const handle &) = delete;
+
+    ~handle();
+
+    [[nodiscard]]
+    bool done() const noexcept;
+
+    /**
+     * Waits for completion.
+     * On worker, keeps running other jobs instead of blocking its thread.
+     */
+    void wait() const;
   };
 
   class job {
-    std::function<void(size_t)> _callback;
+    struct vtable {
+      void (*invoke)(job *origin, size_t begin, size_t end);
+      void (*destroy)(job *origin);
+    };
+
+    template<typename F>
+    static constexpr bool is_inline =
+      sizeof(F) <= JOB_INLINE_SIZE && alignof(F) <= alignof(std::max_align_t);
+
+    template<typename F>
+    static F &body(job *origin) {
+      if constexpr (is_inline<F>) {
+        return *std::launder(reinterpret_cast<F*>(origin->_storage));
+      }
+      else {
+        return **std::launder(reinterpret_cast<F**>(origin->_storage));
+      }
+    }
+
+    template<typename F>
+    static constexpr vtable VTABLE = {
+      [](job *origin, const size_t begin, const size_t end) {
+        auto &callback = body<F>(origin);
+        if constexpr (std::is_invocable_v<F&, size_t, size_t>) {
+          callback(begin, end);
+        }
+        else {
+          for (size_t i = begin; i < end; ++i) {
+            callback(i);
+          }
+        }
+      },
+      [](job *origin) {
+        if constexpr (is_inline<F>) {
+          body<F>(origin).~F();
+        }
+        else {
+          delete &body<F>(origin);
+        }
+      }
+    };
+
+    // callable is owned by origin and shared by pieces split from it
+    const vtable *_vtable;
+    alignas(std::max_align_t) std::byte _storage[JOB_INLINE_SIZE];
+
     job_config _config;
 
+    // predecessors yet to complete; job runs when it drops to zero
     size_t _ref;
     job *_parent;
+    // successors other than parent
+    std::vector<job*> _successors;
+
+    // job whose range this one was split from; self if not split
+    job *_origin;
+
+    // only meaningful for origin
+    size_t _pending;
+    size_t _holds;
+    std::atomic_flag _done = ATOMIC_FLAG_INIT;
 
-    friend class pool<job>;
+    // link in mailbox
+    job *_next = nullptr;
 
-    job(std::function<void(size_t)> callback, const job_config &config, job *parent)
-      : _callback(std::move(callback)),
+    friend class slab<job>;
+    friend class handle;
+    friend class mailbox;
+
+    template<typename F>
+    job(F &&callback, const job_config &config, job *parent)
+      : _vtable(&VTABLE<std::decay_t<F>>),
         _config(config),
         _ref(0),
-        _parent(parent) {
+        _parent(parent),
+        _origin(this),
+        _pending(1),
+        _holds(1) {
+      using T = std::decay_t<F>;
+      if constexpr (is_inline<T>) {
+        new(_storage) T(std::forward<F>(callback));
+      }
+      else {
+        new(_storage) T*(new T(std::forward<F>(callback)));
+      }
+    }
+
+    job(job *origin, const job_config &config)
+      : _vtable(nullptr),
+        _config(config),
+        _ref(0),
+        _parent(nullptr),
+        _origin(origin),
+        _pending(0),
+        _holds(0) {
+    }
+
+    ~job() {
+      if (_vtable) {
+        _vtable->destroy(this);
+      }
+    }
+
+    void yield() {
+      slab<job>::yield(this);
+    }
+
+    void drop() {
+      if (__atomic_sub_fetch(&_holds, 1, __ATOMIC_ACQ_REL) == 0) {
+        yield();
+      }
+    }
+
+    // called on origin when all of its pieces have been called
+    template<typename Spawn>
+    [[nodiscard]]
+    std::optional<job*> finish(Spawn &spawn) {
+      // job may be reclaimed by `drop`
+      const auto parent = _parent;
+      const auto successors = std::move(_successors);
+
+      _done.test_and_set(std::memory_order_release);
+      if (__atomic_load_n(&_holds, __ATOMIC_ACQUIRE) > 1) {
+        _done.notify_all();
+      }
+      drop();
+
+      // first successor to become ready runs inline; rest go to `spawn`
+      std::optional<job*> next;
+      const auto complete = [&next, &spawn](job *successor) {
+        if (__atomic_sub_fetch(&successor->_ref, 1, __ATOMIC_ACQ_REL) == 0) {
+          if (next) {
+            spawn(successor);
+          }
+          else {
+            next = successor;
+          }
+        }
+      };
+
+      if (parent) {
+        complete(parent);
+      }
+      for (const auto successor : successors) {
+        complete(successor);
+      }
+
+      return next;
     }
 
   public:
+    /**
+     * Creates job calling `callback(i)` for each index in range of `config`.
+     * Callable taking `(begin, end)` is called once per piece instead.
+     * Callable is stored in job itself if it fits `JOB_INLINE_SIZE`.
+     */
+    template<typename F>
     [[nodiscard]]
-    static job *create(
-      const std::function<void(size_t)> &callback,
-      const job_config &config,
-      job *parent
-    ) {
+    static job *create(F &&callback, const job_config &config, job *parent) {
       if (parent) {
         __atomic_fetch_add(&parent->_ref, 1, __ATOMIC_ACQ_REL);
+
+        if (!config.cancel && parent->_config.cancel) {
+          auto inherited = config;
+          inherited.cancel = parent->_config.cancel;
+          return slab<job>::rent(std::forward<F>(callback), inherited, parent);
+        }
       }
-      return mt_pool<job>::rent(std::move_if_noexcept(callback), config, parent);
+      return slab<job>::rent(std::forward<F>(callback), config, parent);
     }
 
     job(const job &) = delete;
     job &operator=(const job &) = delete;
 
-    void yield() {
-      mt_pool<job>::yield(this);
+    /**
+     * Makes `successor` run once this job and all other predecessors of it have completed.
+     * Must be called before this job is pushed; successor must not be pushed by hand.
+     * Parent given to `create` is successor as well.
+     */
+    void precede(job *successor) {
+      __atomic_fetch_add(&successor->_ref, 1, __ATOMIC_ACQ_REL);
+      _successors.push_back(successor);
+    }
+
+    /**
+     * Creates completion handle of this job.
+     * Must be called before job is pushed; job may be reclaimed as soon as it completes.
+     */
+    [[nodiscard]]
+    handle watch() {
+      __atomic_fetch_add(&_holds, 1, __ATOMIC_ACQ_REL);
+      return handle(this);
     }
 
     [[nodiscard]]
@@ -63,6 +294,37 @@ namespace ts {
       return _config.begin == _config.end;
     }
 
+    [[nodiscard]]
+    job_priority priority() const {
+      return _config.priority;
+    }
+
+    [[nodiscard]]
+    bool cancelled() const {
+      return _config.cancel.cancelled();
+    }
+
+    [[nodiscard]]
+    bool stealable() const {
+      return _config.stealable;
+    }
+
+    [[nodiscard]]
+    bool lazy() const {
+      return _config.split == split_mode::lazy;
+    }
+
+    /**
+     * Calls first `n` indices and drops them from range.
+     */
+    void advance(const size_t n) {
+      assert(n <= size());
+
+      const auto origin = _origin;
+      origin->_vtable->invoke(origin, _config.begin, _config.begin + n);
+      _config.begin += n;
+    }
+
     [[nodiscard]]
     job *split(const size_t at) {
       // left
@@ -71,20 +333,55 @@ namespace ts {
 
       // right
       config.begin = _config.begin + at;
-      return create(_callback, config, _parent);
+      __atomic_fetch_add(&_origin->_pending, 1, __ATOMIC_ACQ_REL);
+      return slab<job>::rent(_origin, config);
     }
 
+    /**
+     * Calls range of job.
+     * When it completes the origin, successors that become ready are released:
+     * first one is returned to be run inline, others are passed to `spawn(job*)`.
+     *
+     * note: job is reclaimed by this call; don't touch it after
+     */
+    template<typename Spawn>
     [[nodiscard]]
-    std::optional<job*> call() const {
-      for (size_t i = _config.begin; i < _config.end; ++i) {
-        _callback(i);
+    std::optional<job*> call(Spawn &&spawn) {
+      const auto origin = _origin;
+      // cancelled range is dropped, but still completes so that waiters and successors are released
+      if (!cancelled()) {
+        origin->_vtable->invoke(origin, _config.begin, _config.end);
       }
 
-      if (_parent && __atomic_sub_fetch(&_parent->_ref, 1, __ATOMIC_ACQ_REL) == 0) {
-        return _parent;
+      if (origin != this) {
+        yield();
+      }
+
+      if (__atomic_sub_fetch(&origin->_pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        return origin->finish(spawn);
       }
 
       return std::nullopt;
     }
   };
+
+  inline handle &handle::operator=(handle &&other) noexcept {
+    if (this != &other) {
+      if (_job) {
+        _job->drop();
+      }
+      _job = std::exchange(other._job, nullptr);
+    }
+    return *this;
+  }
+
+  inline handle::~handle() {
+    if (_job) {
+      _job->drop();
+    }
+  }
+
+  inline bool handle::done() const noexcept {
+    return !_job || _job->_done.test(acquire);
+  }
 }
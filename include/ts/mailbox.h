@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+
+#include "job.h"
+#include "queue.h"
+
+namespace ts {
+  /**
+   * Intrusive MPSC queue of jobs addressed to single worker.
+   *
+   * Producers push onto lock-free stack; owner takes the whole stack at once
+   * and reverses it into private list, so jobs of each producer come out in push order.
+   */
+  class mailbox {
+    alignas(CACHELINE_SIZE) std::atomic<job*> _inbox = nullptr;
+    // owner only
+    alignas(CACHELINE_SIZE) job *_ready = nullptr;
+
+  public:
+    mailbox() = default;
+
+    mailbox(const mailbox &) = delete;
+    mailbox &operator=(const mailbox &) = delete;
+
+    /**
+     * Callable from any thread.
+     */
+    void push(job *job) noexcept {
+      job->_next = _inbox.load(std::memory_order::relaxed);
+      while (!_inbox.compare_exchange_weak(job->_next, job, std::memory_order::seq_cst, std::memory_order::relaxed)) {
+      }
+    }
+
+    /**
+     * Owner only.
+     */
+    [[nodiscard]]
+    job *pop() noexcept {
+      if (!_ready) {
+        if (!_inbox.load(std::memory_order::relaxed)) {
+          return nullptr;
+        }
+
+        auto list = _inbox.exchange(nullptr, std::memory_order::acquire);
+        while (list) {
+          const auto next = list->_next;
+          list->_next = _ready;
+          _ready = list;
+          list = next;
+        }
+      }
+
+      const auto job = _ready;
+      _ready = job->_next;
+      job->_next = nullptr;
+      return job;
+    }
+
+    /**
+     * Owner only, or once owner has stopped.
+     */
+    [[nodiscard]]
+    bool empty() const noexcept {
+      return !_ready && !_inbox.load(std::memory_order::acquire);
+    }
+  };
+}
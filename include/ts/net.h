@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include "poller.h"
+#include "task.h"
+
+#ifdef TS_EPOLL
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ts {
+  /**
+   * Non-blocking socket registered with poller; owns descriptor.
+   * Must not be destroyed while coroutine waits on it.
+   */
+  class async_socket {
+    io_poller *_poller;
+    poll_entry *_entry;
+    int _fd;
+
+    class ready_awaiter {
+      io_poller &_poller;
+      std::atomic<void*> &_waiter;
+
+    public:
+      ready_awaiter(io_poller &poller, std::atomic<void*> &waiter) noexcept : _poller(poller), _waiter(waiter) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(const std::coroutine_handle<> h) {
+        void *expected = nullptr;
+        if (_waiter.compare_exchange_strong(expected, h.address(), std::memory_order::acq_rel)) {
+          _poller.suspended();
+          return true;
+        }
+
+        // edge arrived since last attempt; consume it and try again
+        _waiter.store(nullptr, std::memory_order::relaxed);
+        return false;
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+  public:
+    /**
+     * Takes ownership of `fd`, makes it non-blocking and registers it.
+     */
+    async_socket(io_poller &poller, const int fd) : _poller(&poller), _entry(nullptr), _fd(fd) {
+      const auto flags = fcntl(fd, F_GETFL);
+      if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw std::system_error(errno, std::system_category());
+      }
+
+      _entry = poller.add(fd);
+    }
+
+    async_socket(async_socket &&other) noexcept
+      : _poller(other._poller),
+        _entry(std::exchange(other._entry, nullptr)),
+        _fd(std::exchange(other._fd, -1)) {
+    }
+
+    async_socket &operator=(async_socket &&other) noexcept {
+      if (this != &other) {
+        close();
+        _poller = other._poller;
+        _entry = std::exchange(other._entry, nullptr);
+        _fd = std::exchange(other._fd, -1);
+      }
+      return *this;
+    }
+
+    async_socket(const async_socket &) = delete;
+    async_socket &operator=(const async_socket &) = delete;
+
+    ~async_socket() {
+      close();
+    }
+
+    [[nodiscard]] int fd() const noexcept { return _fd; }
+    [[nodiscard]] io_poller &poller() const noexcept { return *_poller; }
+
+    void close() {
+      if (_entry) {
+        _poller->remove(std::exchange(_entry, nullptr));
+      }
+      if (_fd >= 0) {
+        ::close(std::exchange(_fd, -1));
+      }
+    }
+
+    /**
+     * Suspends until next readable edge; resumes at once if one came since last wait.
+     */
+    [[nodiscard]]
+    ready_awaiter readable() const noexcept {
+      return {*_poller, _entry->readers};
+    }
+
+    [[nodiscard]]
+    ready_awaiter writable() const noexcept {
+      return {*_poller, _entry->writers};
+    }
+  };
+
+  namespace detail {
+    [[noreturn]] inline void throw_errno() {
+      throw std::system_error(errno, std::system_category());
+    }
+
+    // whether failed call should wait for readiness and retry
+    [[nodiscard]]
+    inline bool should_retry() noexcept {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+  }
+
+  /**
+   * Accepts connection on listening socket, registered with the same poller.
+   */
+  inline task<async_socket> async_accept(async_socket &listener) {
+    for (;;) {
+      const auto fd = accept4(listener.fd(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd >= 0) {
+        co_return async_socket(listener.poller(), fd);
+      }
+      if (!detail::should_retry()) {
+        detail::throw_errno();
+      }
+
+      co_await listener.readable();
+    }
+  }
+
+  inline task<> async_connect(async_socket &socket, const sockaddr *address, const socklen_t length) {
+    if (connect(socket.fd(), address, length) == 0) {
+      co_return;
+    }
+    if (errno != EINPROGRESS) {
+      detail::throw_errno();
+    }
+
+    // edge may predate connect; done only once peer is known
+    for (;;) {
+      co_await socket.writable();
+
+      int error = 0;
+      socklen_t size = sizeof(error);
+      if (getsockopt(socket.fd(), SOL_SOCKET, SO_ERROR, &error, &size) != 0) {
+        detail::throw_errno();
+      }
+      if (error != 0) {
+        throw std::system_error(error, std::system_category());
+      }
+
+      sockaddr_storage peer{};
+      socklen_t peer_size = sizeof(peer);
+      if (getpeername(socket.fd(), reinterpret_cast<sockaddr*>(&peer), &peer_size) == 0) {
+        co_return;
+      }
+      if (errno != ENOTCONN) {
+        detail::throw_errno();
+      }
+    }
+  }
+
+  /**
+   * Receives up to `buffer.size()` bytes.
+   *
+   * @return Number of bytes received; 0 once peer has shut down.
+   */
+  inline task<size_t> async_recv(async_socket &socket, const std::span<std::byte> buffer) {
+    for (;;) {
+      const auto n = recv(socket.fd(), buffer.data(), buffer.size(), 0);
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (!detail::should_retry()) {
+        detail::throw_errno();
+      }
+
+      co_await socket.readable();
+    }
+  }
+
+  /**
+   * Sends up to `buffer.size()` bytes.
+   *
+   * @return Number of bytes sent.
+   */
+  inline task<size_t> async_send(async_socket &socket, const std::span<const std::byte> buffer) {
+    for (;;) {
+      const auto n = send(socket.fd(), buffer.data(), buffer.size(), MSG_NOSIGNAL);
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (!detail::should_retry()) {
+        detail::throw_errno();
+      }
+
+      co_await socket.writable();
+    }
+  }
+}
+#endif
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "scheduler.h"
+#include "slab.h"
+
+namespace ts {
+  template<typename T>
+  struct partial {
+    size_t begin;
+    size_t end;
+    T value;
+  };
+
+  /**
+   * Partial results of pieces of single job.
+   *
+   * Each worker folds ranges it runs back to back into one open partial,
+   * so batches of lazily advanced piece, or eagerly split halves popped in turn, end up as one partial;
+   * only ranges taken apart by steals are left to combine serially.
+   * Open partial is closed into shared list once its worker moves to range not adjacent to it.
+   * Partials are collected in range order once job has completed.
+   */
+  template<typename T>
+  class partials {
+    struct node {
+      partial<T> value;
+      node *next;
+    };
+
+    // touched only by worker of same id until `collect`
+    struct alignas(CACHELINE_SIZE) slot {
+      std::optional<partial<T>> open;
+    };
+
+    scheduler &_scheduler;
+    std::vector<slot> _slots;
+    std::atomic<node*> _head = nullptr;
+
+    void close(partial<T> &&value) {
+      const auto n = slab<node>::rent(std::move(value), _head.load(relaxed));
+      while (!_head.compare_exchange_weak(n->next, n, release, relaxed)) {
+      }
+    }
+
+  public:
+    explicit partials(scheduler &sch)
+      : _scheduler(sch), _slots(sch.config().worker_count + sch.config().spare_count) {
+    }
+
+    partials(const partials &) = delete;
+    partials &operator=(const partials &) = delete;
+
+    ~partials() {
+      auto n = _head.load(relaxed);
+      while (n) {
+        slab<node>::yield(std::exchange(n, n->next));
+      }
+    }
+
+    template<typename Combine>
+    void add(const size_t begin, const size_t end, T value, const Combine &combine) {
+      const auto current = _scheduler.current_worker();
+      if (!current) {
+        close(partial<T>{begin, end, std::move(value)});
+        return;
+      }
+
+      auto &open = _slots[current->id()].open;
+      if (open && open->end == begin) {
+        open->value = combine(std::move(open->value), std::move(value));
+        open->end = end;
+        return;
+      }
+
+      if (open) {
+        close(std::move(*open));
+      }
+      open = partial<T>{begin, end, std::move(value)};
+    }
+
+    /**
+     * Takes every partial, sorted by range.
+     * Must be called after job has completed.
+     */
+    [[nodiscard]]
+    std::vector<partial<T>> collect() {
+      std::vector<partial<T>> result;
+
+      for (auto &slot : _slots) {
+        if (slot.open) {
+          result.push_back(std::move(*slot.open));
+          slot.open.reset();
+        }
+      }
+
+      auto n = _head.exchange(nullptr, acquire);
+      while (n) {
+        result.push_back(std::move(n->value));
+        slab<node>::yield(std::exchange(n, n->next));
+      }
+
+      std::ranges::sort(result, {}, &partial<T>::begin);
+      return result;
+    }
+  };
+
+  namespace detail {
+    [[noreturn]] inline void throw_cancelled() {
+      throw std::system_error(std::make_error_code(std::errc::operation_canceled));
+    }
+  }
+
+  /**
+   * Reduces range in `config` into partials of adjacent pieces.
+   * Pieces are formed by the same split and steal as any other job.
+   * Throws `std::system_error` with `operation_canceled` if `config.cancel` dropped any piece.
+   */
+  template<typename T, typename Map, typename Combine>
+  std::vector<partial<T>> reduce_pieces(
+    scheduler &sch,
+    const job_config &config,
+    const T &identity,
+    const Map &map,
+    const Combine &combine
+  ) {
+    partials<T> partials(sch);
+
+    sch.submit(
+      job::create(
+        [&partials, &identity, &map, &combine](const size_t begin, const size_t end) {
+          T acc = identity;
+          for (size_t i = begin; i < end; ++i) {
+            acc = combine(std::move(acc), map(i));
+          }
+          partials.add(begin, end, std::move(acc), combine);
+        },
+        config, nullptr
+      )
+    ).wait();
+
+    auto result = partials.collect();
+
+    size_t covered = 0;
+    for (const auto &piece : result) {
+      covered += piece.end - piece.begin;
+    }
+    if (covered != config.end - config.begin) {
+      detail::throw_cancelled();
+    }
+    return result;
+  }
+
+  /**
+   * Computes `map(begin) ⊕ ... ⊕ map(end - 1)` where `⊕` is `combine`.
+   * `identity` must be neutral to `combine`; each piece starts from it.
+   * Each piece folds its indices locally; partials are combined in range order,
+   * so `combine` only has to be associative.
+   * On worker, other jobs keep running while waiting.
+   * Throws `std::system_error` with `operation_canceled` if `config.cancel` fired before every index was reduced.
+   */
+  template<typename T, typename Map, typename Combine>
+  T parallel_reduce(scheduler &sch, const job_config &config, T identity, const Map &map, const Combine &combine) {
+    auto pieces = reduce_pieces(sch, config, identity, map, combine);
+
+    T result = std::move(identity);
+    for (auto &piece : pieces) {
+      result = combine(std::move(result), std::move(piece.value));
+    }
+    return result;
+  }
+
+  /**
+   * Inclusive scan; calls `out(i, map(begin) ⊕ ... ⊕ map(i))` for every index.
+   * First pass reduces range into partials, second pass rescans each partial's range from total of those before it;
+   * `map` is called twice per index.
+   * Throws `std::system_error` with `operation_canceled` if `config.cancel` fired before every index was called;
+   * `out` may have been called for some of them.
+   *
+   * @return Total of range.
+   */
+  template<typename T, typename Map, typename Combine, typename Out>
+  T parallel_scan(
+    scheduler &sch,
+    const job_config &config,
+    T identity,
+    const Map &map,
+    const Combine &combine,
+    const Out &out
+  ) {
+    const auto pieces = reduce_pieces(sch, config, identity, map, combine);
+
+    // exclusive prefix of each piece
+    std::vector<T> prefixes;
+    prefixes.reserve(pieces.size());
+
+    T total = std::move(identity);
+    for (const auto &piece : pieces) {
+      prefixes.push_back(total);
+      total = combine(std::move(total), piece.value);
+    }
+
+    auto rescan = config;
+    rescan.begin = 0;
+    rescan.end = pieces.size();
+    rescan.batch_size = 1;
+    rescan.split = split_mode::eager;
+
+    std::atomic_size_t rescanned = 0;
+    sch.submit(
+      job::create(
+        [&pieces, &prefixes, &map, &combine, &out, &rescanned](const size_t p) {
+          T acc = prefixes[p];
+          for (size_t i = pieces[p].begin; i < pieces[p].end; ++i) {
+            acc = combine(std::move(acc), map(i));
+            out(i, acc);
+          }
+          rescanned.fetch_add(1, relaxed);
+        },
+        rescan, nullptr
+      )
+    ).wait();
+
+    if (rescanned.load(relaxed) != pieces.size()) {
+      detail::throw_cancelled();
+    }
+    return total;
+  }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "queue.h"
+
+namespace ts {
+  /**
+   * Sleeper blocked outside of `eventcount`, e.g. in kernel, and woken by its own means.
+   */
+  class waker {
+  public:
+    virtual void wake() noexcept = 0;
+
+  protected:
+    ~waker() = default;
+  };
+
+  /**
+   * Waker of thread that has nothing else to block on.
+   */
+  class parker final : public waker {
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _woken = false;
+
+  public:
+    /**
+     * Sleeps until woken or `deadline`; wakeup issued before the call ends it at once.
+     */
+    void wait(const std::optional<std::chrono::steady_clock::time_point> deadline) {
+      std::unique_lock lock(_mutex);
+      if (deadline) {
+        _cv.wait_until(lock, *deadline, [this] { return _woken; });
+      }
+      else {
+        _cv.wait(lock, [this] { return _woken; });
+      }
+      _woken = false;
+    }
+
+    void wake() noexcept override {
+      {
+        std::lock_guard lock(_mutex);
+        _woken = true;
+      }
+      _cv.notify_one();
+    }
+  };
+
+  /**
+   * Event count to park idle workers.
+   *
+   * Waiter announces itself with `prepare`, checks for work once more,
+   * then either `arm`s its waker and sleeps or `cancel`s.
+   * Any notification issued after `prepare` prevents or ends the sleep,
+   * so a push racing with a parking worker is never lost.
+   *
+   * Notifiers only pay a fence and a load while nobody is parked.
+   */
+  class eventcount {
+    alignas(CACHELINE_SIZE) std::atomic_size_t _waiters;
+    alignas(CACHELINE_SIZE) std::atomic_uint64_t _epoch;
+
+    struct sleeper {
+      waker *target;
+      const void *owner;
+    };
+
+    // guards `_armed` and epoch changes, so that sleeper can't miss one between check and `arm`
+    std::mutex _mutex;
+    std::vector<sleeper> _armed;
+
+    void bump(size_t n) {
+      std::lock_guard lock(_mutex);
+      _epoch.fetch_add(1, std::memory_order::seq_cst);
+
+      while (n > 0 && !_armed.empty()) {
+        _armed.back().target->wake();
+        _armed.pop_back();
+        n--;
+      }
+    }
+
+  public:
+    eventcount() : _waiters(0), _epoch(0) {
+    }
+
+    eventcount(const eventcount &) = delete;
+    eventcount &operator=(const eventcount &) = delete;
+
+    [[nodiscard]]
+    size_t waiters() const noexcept {
+      return _waiters.load(std::memory_order::seq_cst);
+    }
+
+    /**
+     * Announces that calling thread is going to sleep.
+     *
+     * @return Key to pass to `arm`.
+     */
+    [[nodiscard]]
+    uint64_t prepare() noexcept {
+      _waiters.fetch_add(1, std::memory_order::seq_cst);
+      return _epoch.load(std::memory_order::seq_cst);
+    }
+
+    void cancel() noexcept {
+      _waiters.fetch_sub(1, std::memory_order::seq_cst);
+    }
+
+    /**
+     * Registers `w` to be woken on notification after `prepare` returned `key`; caller then blocks on its own.
+     * `owner` lets `notify_owner` pick this sleeper.
+     * Pair with `disarm` whether or not it slept.
+     *
+     * @return False if already notified; sleep must be skipped.
+     */
+    [[nodiscard]]
+    bool arm(const uint64_t key, waker &w, const void *owner = nullptr) {
+      std::lock_guard lock(_mutex);
+      if (_epoch.load(std::memory_order::relaxed) != key) {
+        return false;
+      }
+
+      _armed.push_back({&w, owner});
+      return true;
+    }
+
+    /**
+     * Ends wait started by `prepare` and `arm`; `w` is not woken afterward.
+     */
+    void disarm(waker &w) {
+      {
+        std::lock_guard lock(_mutex);
+        std::erase_if(_armed, [&w](const sleeper &s) { return s.target == &w; });
+      }
+      _waiters.fetch_sub(1, std::memory_order::seq_cst);
+    }
+
+    /**
+     * Wakes sleeper armed with `owner`.
+     * Every other waiter that hasn't slept yet re-checks too, so owner can't miss it while parking.
+     */
+    void notify_owner(const void *owner) {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (_waiters.load(std::memory_order::seq_cst) == 0) {
+        return;
+      }
+
+      std::lock_guard lock(_mutex);
+      _epoch.fetch_add(1, std::memory_order::seq_cst);
+
+      const auto it = std::ranges::find(_armed, owner, &sleeper::owner);
+      if (it != _armed.end()) {
+        it->target->wake();
+        _armed.erase(it);
+      }
+    }
+
+    /**
+     * Wakes one sleeper, if any.
+     */
+    void notify_one() {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (_waiters.load(std::memory_order::seq_cst) == 0) {
+        return;
+      }
+
+      bump(1);
+    }
+
+    /**
+     * Wakes up to `n` sleepers with single epoch change.
+     */
+    void notify(const size_t n) {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (n == 0 || _waiters.load(std::memory_order::seq_cst) == 0) {
+        return;
+      }
+
+      bump(n);
+    }
+
+    void notify_all() {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+      if (_waiters.load(std::memory_order::seq_cst) == 0) {
+        return;
+      }
+
+      bump(waiters());
+    }
+  };
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<sys/epoll.h>)
+#define TS_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include "job.h"
+#include "park.h"
+
+namespace ts {
+  // events fetched by single `epoll_wait`
+  constexpr size_t POLLER_BATCH_SIZE = 64;
+
+  /**
+   * Readiness state of registered descriptor.
+   *
+   * Each direction holds null, `READY` once an edge arrived with nobody waiting,
+   * or address of the single coroutine waiting for next edge.
+   * Entries are recycled, never freed, while poller lives;
+   * stale event may flag recycled entry, which only costs its next waiter one more attempt.
+   */
+  struct poll_entry {
+    static inline const auto READY = reinterpret_cast<void*>(1);
+
+    int fd = -1;
+    std::atomic<void*> readers = nullptr;
+    std::atomic<void*> writers = nullptr;
+  };
+
+#ifdef TS_EPOLL
+  /**
+   * Edge-triggered epoll instance of scheduler, shared by workers.
+   *
+   * Workers out of local work poll it with zero timeout, one at a time.
+   * One parked worker at a time blocks in it instead, woken by readiness or through eventfd by `eventcount`.
+   * Ready waiters are resumed from deque of worker that saw the event.
+   */
+  class io_poller final : public waker {
+    int _epoll = -1;
+    int _wake = -1;
+    eventcount &_idle;
+
+    std::mutex _mutex;
+    std::deque<poll_entry> _entries;
+    std::vector<poll_entry*> _free;
+
+    std::atomic_size_t _registered = 0;
+    std::atomic_flag _polling = ATOMIC_FLAG_INIT;
+    std::atomic_flag _keeper = ATOMIC_FLAG_INIT;
+
+    template<typename Push>
+    static bool signal(std::atomic<void*> &waiter, Push &push) {
+      const auto previous = waiter.exchange(poll_entry::READY, std::memory_order::acq_rel);
+      if (!previous || previous == poll_entry::READY) {
+        return false;
+      }
+
+      const auto h = std::coroutine_handle<>::from_address(previous);
+      push(job::create([h](size_t) { h.resume(); }, {}, nullptr));
+      return true;
+    }
+
+    template<typename Push>
+    size_t dispatch(const epoll_event *events, const int count, Push &push) {
+      size_t resumed = 0;
+
+      for (int i = 0; i < count; ++i) {
+        const auto entry = static_cast<poll_entry*>(events[i].data.ptr);
+        if (!entry) {
+          // wake eventfd; drained by blocking waiter
+          continue;
+        }
+
+        const auto flags = events[i].events;
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+          resumed += signal(entry->readers, push);
+        }
+        if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+          resumed += signal(entry->writers, push);
+        }
+      }
+
+      return resumed;
+    }
+
+  public:
+    explicit io_poller(eventcount &idle) : _idle(idle) {
+      _epoll = epoll_create1(EPOLL_CLOEXEC);
+      _wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+      // level-triggered, so that zero-timeout polls can't swallow wakeup meant for blocking waiter
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.ptr = nullptr;
+      if (_epoll < 0 || _wake < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, _wake, &event) != 0) {
+        if (_epoll >= 0) {
+          close(_epoll);
+        }
+        if (_wake >= 0) {
+          close(_wake);
+        }
+        _epoll = _wake = -1;
+      }
+    }
+
+    io_poller(const io_poller &) = delete;
+    io_poller &operator=(const io_poller &) = delete;
+
+    ~io_poller() {
+      if (_epoll >= 0) {
+        close(_epoll);
+        close(_wake);
+      }
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return _epoll >= 0; }
+
+    [[nodiscard]]
+    bool registered() const noexcept {
+      return _registered.load(std::memory_order::relaxed) > 0;
+    }
+
+    /**
+     * Registers non-blocking `fd` for both directions, edge-triggered.
+     */
+    [[nodiscard]]
+    poll_entry *add(const int fd) {
+      poll_entry *entry;
+      {
+        std::lock_guard lock(_mutex);
+        if (_free.empty()) {
+          entry = &_entries.emplace_back();
+        }
+        else {
+          entry = _free.back();
+          _free.pop_back();
+        }
+      }
+
+      entry->fd = fd;
+      entry->readers.store(nullptr, std::memory_order::relaxed);
+      entry->writers.store(nullptr, std::memory_order::relaxed);
+
+      epoll_event event{};
+      event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+      event.data.ptr = entry;
+      if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        const auto error = errno;
+        remove(entry);
+        throw std::system_error(error, std::system_category());
+      }
+
+      _registered.fetch_add(1, std::memory_order::relaxed);
+      return entry;
+    }
+
+    void remove(poll_entry *entry) {
+      if (epoll_ctl(_epoll, EPOLL_CTL_DEL, entry->fd, nullptr) == 0) {
+        _registered.fetch_sub(1, std::memory_order::relaxed);
+      }
+
+      entry->fd = -1;
+      std::lock_guard lock(_mutex);
+      _free.push_back(entry);
+    }
+
+    /**
+     * Called once coroutine waits on entry; makes sure some parked worker watches for it.
+     */
+    void suspended() {
+      if (!_keeper.test(std::memory_order::acquire)) {
+        _idle.notify_one();
+      }
+    }
+
+    /**
+     * Resumes ready waiters through `push(job*)` without blocking.
+     * Skipped if another thread is polling.
+     *
+     * @return Whether any waiter was resumed.
+     */
+    template<typename Push>
+    bool poll(Push &&push) {
+      if (!registered() || _polling.test(std::memory_order::relaxed)
+        || _polling.test_and_set(std::memory_order::acquire)) {
+        return false;
+      }
+
+      epoll_event events[POLLER_BATCH_SIZE];
+      const auto count = epoll_wait(_epoll, events, POLLER_BATCH_SIZE, 0);
+      const auto resumed = count > 0 ? dispatch(events, count, push) : 0;
+
+      _polling.clear(std::memory_order::release);
+      return resumed > 0;
+    }
+
+    /**
+     * Claims blocking wait; at most one parked worker sleeps in poller.
+     */
+    [[nodiscard]]
+    bool keep() {
+      return registered() && !_keeper.test_and_set(std::memory_order::acquire);
+    }
+
+    void release_keeper() {
+      _keeper.clear(std::memory_order::release);
+    }
+
+    /**
+     * Sleeps until readiness, `wake` or `deadline`, resuming ready waiters through `push(job*)`.
+     * Must hold keeper.
+     */
+    template<typename Push>
+    void wait(const std::optional<std::chrono::steady_clock::time_point> deadline, Push &&push) {
+      int timeout = -1;
+      if (deadline) {
+        const auto left = *deadline - std::chrono::steady_clock::now();
+        // round up; waking early would only spin
+        timeout = static_cast<int>(std::max<int64_t>(
+          0, std::chrono::ceil<std::chrono::milliseconds>(left).count()
+        ));
+      }
+
+      epoll_event events[POLLER_BATCH_SIZE];
+      const auto count = epoll_wait(_epoll, events, POLLER_BATCH_SIZE, timeout);
+      if (count > 0) {
+        dispatch(events, count, push);
+      }
+
+      uint64_t value;
+      [[maybe_unused]] const auto n = read(_wake, &value, sizeof(value));
+    }
+
+    void wake() noexcept override {
+      const uint64_t one = 1;
+      [[maybe_unused]] const auto n = write(_wake, &one, sizeof(one));
+    }
+  };
+#else
+  // epoll is unavailable; sockets can't be registered
+  class io_poller final : public waker {
+  public:
+    explicit io_poller(eventcount &) {
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return false; }
+    [[nodiscard]] bool registered() const noexcept { return false; }
+
+    [[nodiscard]]
+    poll_entry *add(int) {
+      throw std::system_error(std::make_error_code(std::errc::function_not_supported));
+    }
+
+    void remove(poll_entry *) {
+    }
+
+    void suspended() {
+    }
+
+    template<typename Push>
+    bool poll(Push &&) {
+      return false;
+    }
+
+    [[nodiscard]] bool keep() { return false; }
+
+    void release_keeper() {
+    }
+
+    template<typename Push>
+    void wait(std::optional<std::chrono::steady_clock::time_point>, Push &&) {
+    }
+
+    void wake() noexcept override {
+    }
+  };
+#endif
+}
@@ -3,10 +3,14 @@
 #define TS_QUEUE_H
 
 #include <atomic>
+#include <bit>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <vector>
 
+#include "reclaim.h"
+
 namespace ts {
   /**
    * Unbounded ring queue
@@ -30,48 +34,6 @@ namespace ts {
     std::optional<T> pop();
   };
 
-  /**
-   * Object pool implementation
-   * for single-thread
-   * based on unbounded ring queue
-   */
-  template<typename T>
-  class pool {
-    queue<T*> _queue;
-
-  public:
-    pool();
-    ~pool();
-
-    template<typename... Args>
-    T *rent(Args &&... args);
-
-    void yield(T *p);
-  };
-
-  /**
-   * Object pool implementation
-   * for multi-thread
-   * based on thread-local object pool
-   */
-  template<typename T>
-  class mt_pool {
-    static pool<T> *inner() {
-      thread_local pool<T> inner;
-      return &inner;
-    }
-
-  public:
-    template<typename... Args>
-    static T *rent(Args &&... args) {
-      return inner()->rent(std::forward<Args>(args)...);
-    }
-
-    static void yield(T *p) {
-      inner()->yield(p);
-    }
-  };
-
   constexpr size_t CACHELINE_SIZE = std::hardware_destructive_interference_size;
 
   template<typename T>
@@ -91,8 +53,11 @@ namespace ts {
     size_t _mask;
 
     std::atomic_size_t _available;
+    std::atomic_size_t _waiters;
     std::atomic_flag _alive = ATOMIC_FLAG_INIT;
 
+    void notify();
+
     alignas(CACHELINE_SIZE) std::atomic_size_t _head;
     alignas(CACHELINE_SIZE) std::atomic_size_t _tail;
 
@@ -101,15 +66,62 @@ namespace ts {
 
     bool push(T x);
     bool blocking_push(T x);
+
+    /**
+     * Pushes items in order, reserving their slots with single atomic operation.
+     *
+     * @return Number of items pushed; less than `count` if queue has fewer free slots.
+     */
+    size_t push_bulk(const T *items, size_t count);
+
     std::optional<T> pop();
     std::optional<T> blocking_pop();
 
+    // note: approximation; counts item only once push completes, so it may lag behind pop
+    [[nodiscard]] bool empty() const;
+
     void kill();
 
     // note: ignores inner items; may leak
     void unsafe_reset();
   };
 
+  /**
+   * Bounded single-producer single-consumer ring.
+   * Each side caches index of the other, so it reads shared line only once its cached view runs out.
+   */
+  template<typename T>
+  class spsc {
+    std::unique_ptr<T[]> _buffer;
+    size_t _mask;
+
+    alignas(CACHELINE_SIZE) std::atomic_size_t _head;
+    // consumer only
+    size_t _tail_cache;
+
+    alignas(CACHELINE_SIZE) std::atomic_size_t _tail;
+    // producer only
+    size_t _head_cache;
+
+  public:
+    /**
+     * @param size Capacity of ring. Must be power of 2.
+     */
+    explicit spsc(size_t size);
+
+    // producer only
+    bool push(T x);
+
+    // consumer only
+    std::optional<T> pop();
+
+    // note: exact only for consumer; approximation for others
+    [[nodiscard]] bool empty() const;
+
+    // note: ignores inner items; may leak
+    void unsafe_reset();
+  };
+
   template<typename T>
   class buffer_desc {
     std::atomic<T> *_data;
@@ -133,10 +145,15 @@ namespace ts {
     void store(size_t i, T x, std::memory_order order);
   };
 
+  /**
+   * Growable buffer of deque.
+   * Replaced descriptors are retired to global epoch domain; thieves must read under `epoch_domain::pin`.
+   */
   template<typename T>
   class buffer {
     std::atomic<buffer_desc<T>*> _inner;
-    buffer_desc<T> *_past;
+    // owner only; descriptor with epoch it was retired at
+    std::vector<std::pair<uint64_t, buffer_desc<T>*>> _retired;
 
   public:
     explicit buffer(size_t size);
@@ -148,16 +165,26 @@ namespace ts {
 
     [[nodiscard]] buffer_desc<T> *get(std::memory_order order) const { return _inner.load(order); }
 
-    void resize(size_t begin, size_t end);
+    void resize(size_t begin, size_t end, size_t size);
+
+    // frees retired descriptors no thief can still see
+    void reclaim();
   };
 
   /**
    * Unbounded chase-lev deque implementation.
    */
+  // empty takes between two shrinks of deque
+  constexpr size_t CHASELEV_SHRINK_INTERVAL = 1024;
+
   template<atom T>
   class chaselev {
     buffer<T> _buffer;
 
+    // owner only
+    size_t _min_capacity;
+    size_t _empty_takes;
+
     alignas(CACHELINE_SIZE) std::atomic_size_t _bottom;
     alignas(CACHELINE_SIZE) std::atomic_size_t _top;
 
@@ -165,14 +192,36 @@ namespace ts {
     /**
      * Creates new deque.
      *
-     * @param size Capacity of deque. Must be power of 2.
+     * @param size Initial capacity of deque. Must be power of 2.
+     * Deque grows when full and shrinks back toward it while empty.
      */
     explicit chaselev(size_t size);
 
+    [[nodiscard]] size_t capacity() const { return _buffer.get(std::memory_order::relaxed)->size(); }
+
+    // note: exact only for owner; approximation for others
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
     std::optional<T> take();
     std::optional<T> steal();
+
+    /**
+     * Steals up to half of items; first one is returned and the rest are pushed into `into`.
+     * Items are still claimed one CAS each, so it saves thief later probes of victim rather than atomics.
+     *
+     * @param into Deque owned by calling thread.
+     */
+    std::optional<T> steal_half(chaselev &into);
+
     void push(T x);
     bool try_push(T x);
+
+    /**
+     * Moves items into freshly allocated buffer of same capacity.
+     * Owner calls it after migrating to another CPU so that buffer pages are first touched on its NUMA node.
+     */
+    void rehome();
   };
 }
 
@@ -4,6 +4,7 @@
 #error "Do not include queue.impl.h directly; Use queue.h instead."
 #endif
 
+#include <algorithm>
 #include <cassert>
 #if defined(__i386__) || defined(__x86_64__)
 #include <emmintrin.h>
@@ -75,59 +76,12 @@ namespace ts {
 #endif
   }
 
-  template<typename T>
-  pool<T>::pool() {
-  }
-
-  template<typename T>
-  pool<T>::~pool() {
-    while (true) {
-      if (auto p = _queue.pop()) {
-        ::operator delete(p.value());
-        continue;
-      }
-
-      break;
-    }
-  }
-
-  template<typename T>
-  template<typename... Args>
-  T *pool<T>::rent(Args &&... args) {
-    if (auto v = _queue.pop()) {
-      auto p = v.value();
-      try {
-        new(p) T(std::forward<Args>(args)...);
-        return p;
-      }
-      catch (...) {
-        delete p;
-        throw;
-      }
-    }
-
-    return new T(std::forward<Args>(args)...);
-  }
-
-  template<typename T>
-  void pool<T>::yield(T *p) {
-    assert(p != nullptr);
-
-    p->~T();
-    try {
-      _queue.push(p);
-    }
-    catch (...) {
-      delete p;
-      throw;
-    }
-  }
-
   template<typename T>
   vyukov<T>::vyukov(const size_t size)
     : _buffer(size),
       _mask(size - 1),
       _available(0),
+      _waiters(0),
       _head(0),
       _tail(0) {
     assert(std::popcount(size) == 1);
@@ -140,6 +94,14 @@ namespace ts {
     std::atomic_thread_fence(release);
   }
 
+  // only blocking operations wait on `_available`; skip futex wake when nobody does
+  template<typename T>
+  void vyukov<T>::notify() {
+    if (_waiters.load(seq_cst) != 0) {
+      _available.notify_all();
+    }
+  }
+
   template<typename T>
   bool vyukov<T>::push(T x) {
     slot *c;
@@ -167,19 +129,63 @@ namespace ts {
     c->data = x;
     c->seq.store(pos + 1, release);
 
-    _available.fetch_add(1, release);
-    _available.notify_one();
+    _available.fetch_add(1, seq_cst);
+    notify();
     return true;
   }
 
+  template<typename T>
+  size_t vyukov<T>::push_bulk(const T *items, const size_t count) {
+    const auto capacity = _mask + 1;
+
+    size_t n;
+    auto pos = _tail.load(relaxed);
+    for (;;) {
+      // `_head` counts claims, not releases; stale value only underestimates free slots
+      const auto used = static_cast<ptrdiff_t>(pos - _head.load(acquire));
+      const auto free = used <= 0 ? capacity
+        : static_cast<size_t>(used) >= capacity ? 0 : capacity - static_cast<size_t>(used);
+
+      n = std::min(count, free);
+      if (n == 0) {
+        return 0;
+      }
+
+      if (_tail.compare_exchange_weak(pos, pos + n, relaxed)) {
+        break;
+      }
+
+      may_relax();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      auto &c = _buffer[(pos + i) & _mask];
+
+      // consumer of previous lap has claimed slot, but may not have released it yet
+      while (c.seq.load(acquire) != pos + i) {
+        may_relax();
+      }
+
+      c.data = items[i];
+      c.seq.store(pos + i + 1, release);
+    }
+
+    _available.fetch_add(n, seq_cst);
+    notify();
+    return n;
+  }
+
   template<typename T>
   bool vyukov<T>::blocking_push(T x) {
+    _waiters.fetch_add(1, seq_cst);
+
     bool alive;
     do {
-      _available.wait(_mask + 1, acquire);
+      _available.wait(_mask + 1, seq_cst);
       alive = _alive.test(acquire);
     } while (alive && !push(std::move(x)));
 
+    _waiters.fetch_sub(1, seq_cst);
     return alive;
   }
 
@@ -210,27 +216,35 @@ namespace ts {
     auto data = std::move_if_noexcept(c->data);
     c->seq.store(pos + _mask + 1, release);
 
-    _available.fetch_sub(1, acq_rel);
-    _available.notify_one();
+    _available.fetch_sub(1, seq_cst);
+    notify();
     return std::move_if_noexcept(data);
   }
 
+  template<typename T>
+  bool vyukov<T>::empty() const {
+    return _available.load(relaxed) == 0;
+  }
+
   template<typename T>
   std::optional<T> vyukov<T>::blocking_pop() {
+    _waiters.fetch_add(1, seq_cst);
+
+    std::optional<T> v;
     for (;;) {
       bool alive;
       do {
-        _available.wait(0, acquire);
+        _available.wait(0, seq_cst);
         alive = _alive.test(acquire);
-      } while (_available.load(acquire) <= 0 && alive);
+      } while (_available.load(seq_cst) <= 0 && alive);
 
-      if (auto v = pop())
-        return v;
-
-      if (!alive) {
-        return std::nullopt;
+      if ((v = pop()) || !alive) {
+        break;
       }
     }
+
+    _waiters.fetch_sub(1, seq_cst);
+    return v;
   }
 
   template<typename T>
@@ -257,6 +271,60 @@ namespace ts {
   }
 
 
+  template<typename T>
+  spsc<T>::spsc(const size_t size)
+    : _buffer(new T[size]),
+      _mask(size - 1),
+      _head(0),
+      _tail_cache(0),
+      _tail(0),
+      _head_cache(0) {
+    assert(std::popcount(size) == 1);
+  }
+
+  template<typename T>
+  bool spsc<T>::push(T x) {
+    const auto tail = _tail.load(relaxed);
+    if (tail - _head_cache > _mask) {
+      _head_cache = _head.load(acquire);
+      if (tail - _head_cache > _mask) {
+        return false;
+      }
+    }
+
+    _buffer[tail & _mask] = std::move(x);
+    _tail.store(tail + 1, release);
+    return true;
+  }
+
+  template<typename T>
+  std::optional<T> spsc<T>::pop() {
+    const auto head = _head.load(relaxed);
+    if (head == _tail_cache) {
+      _tail_cache = _tail.load(acquire);
+      if (head == _tail_cache) {
+        return std::nullopt;
+      }
+    }
+
+    auto data = std::move_if_noexcept(_buffer[head & _mask]);
+    _head.store(head + 1, release);
+    return std::move_if_noexcept(data);
+  }
+
+  template<typename T>
+  bool spsc<T>::empty() const {
+    return _head.load(relaxed) == _tail.load(acquire);
+  }
+
+  template<typename T>
+  void spsc<T>::unsafe_reset() {
+    _head.store(0, release);
+    _tail.store(0, release);
+    _head_cache = 0;
+    _tail_cache = 0;
+  }
+
   template<typename T>
   buffer_desc<T>::buffer_desc(const size_t size): _data(new std::atomic<T>[size]), _size(size), _mask(size - 1) {
     assert(std::popcount(size) == 1);
@@ -284,39 +352,72 @@ namespace ts {
 
 
   template<typename T>
-  buffer<T>::buffer(const size_t size) : _inner(new buffer_desc<T>(size)), _past(nullptr) {
+  buffer<T>::buffer(const size_t size) : _inner(new buffer_desc<T>(size)) {
     assert(std::popcount(size) == 1);
   }
 
   template<typename T>
   buffer<T>::~buffer() {
     delete _inner.load(acquire);
-    delete _past;
+
+    // nobody can steal from destroyed deque
+    for (const auto &[epoch, desc] : _retired) {
+      delete desc;
+    }
+  }
+
+  template<typename T>
+  void buffer<T>::reclaim() {
+    if (_retired.empty()) {
+      return;
+    }
+
+    auto &domain = epoch_domain::global();
+    domain.try_advance();
+
+    std::erase_if(_retired, [&domain](const auto &retired) {
+      if (domain.reclaimable(retired.first)) {
+        delete retired.second;
+        return true;
+      }
+      return false;
+    });
   }
 
   template<typename T>
-  void buffer<T>::resize(const size_t begin, const size_t end) {
+  void buffer<T>::resize(const size_t begin, const size_t end, const size_t new_size) {
     const auto inner = _inner.load(relaxed);
-    const auto new_size = inner->size() * 2;
+    assert(end - begin <= new_size);
 
     auto new_inner = new buffer_desc<T>(new_size);
     for (size_t i = begin; i < end; i++) {
       new_inner->store(i % new_size, inner->load(i % inner->size(), relaxed), relaxed);
     }
 
-    delete _past;
-    _past = _inner.exchange(new_inner, release);
+    const auto old = _inner.exchange(new_inner, release);
+    _retired.emplace_back(epoch_domain::global().epoch(), old);
+    reclaim();
   }
 
 
   template<atom T>
   chaselev<T>::chaselev(const size_t size)
     : _buffer(size),
+      _min_capacity(size),
+      _empty_takes(0),
       _bottom(0),
       _top(0) {
     assert(std::popcount(size) == 1);
   }
 
+  template<atom T>
+  size_t chaselev<T>::size() const {
+    const auto bottom = _bottom.load(relaxed);
+    const auto top = _top.load(relaxed);
+    const auto size = static_cast<ptrdiff_t>(bottom - top);
+    return size < 0 ? 0 : static_cast<size_t>(size);
+  }
+
   /*
    * Implementation of chase-lev deque is from below paper:
    *
@@ -334,9 +435,20 @@ namespace ts {
     std::atomic_thread_fence(seq_cst);
 
     auto top = _top.load(relaxed);
-    if (top > bottom) {
+    // signed; `bottom` wraps below zero on fresh deque
+    if (static_cast<ptrdiff_t>(bottom - top) < 0) {
       /* queue is empty; restore */
       _bottom.store(bottom + 1, relaxed);
+
+      // give back memory held since last burst, half at a time
+      if (++_empty_takes % CHASELEV_SHRINK_INTERVAL == 0) {
+        if (array->size() > _min_capacity) {
+          _buffer.resize(bottom + 1, bottom + 1, array->size() / 2);
+        }
+        else {
+          _buffer.reclaim();
+        }
+      }
       return std::nullopt;
     }
 
@@ -357,9 +469,11 @@ namespace ts {
 
   template<atom T>
   std::optional<T> chaselev<T>::steal() {
+    const auto guard = epoch_domain::global().pin();
+
     auto top = _top.load(acquire);
     std::atomic_thread_fence(seq_cst);
-    if (top >= _bottom.load(acquire)) {
+    if (static_cast<ptrdiff_t>(_bottom.load(acquire) - top) <= 0) {
       return std::nullopt;
     }
 
@@ -373,6 +487,52 @@ namespace ts {
     return x;
   }
 
+  template<atom T>
+  std::optional<T> chaselev<T>::steal_half(chaselev &into) {
+    const auto guard = epoch_domain::global().pin();
+
+    auto top = _top.load(acquire);
+    std::atomic_thread_fence(seq_cst);
+    const auto size = static_cast<ptrdiff_t>(_bottom.load(acquire) - top);
+    if (size <= 0) {
+      return std::nullopt;
+    }
+
+    /*
+     * Owner takes from bottom without CAS unless it reaches last item,
+     * so claiming several items with a single CAS on `_top` could race with it:
+     * between our read of `_bottom` and the CAS, owner may take claimed items and even push new ones into their slots,
+     * which no re-check of `_bottom` afterwards can tell apart.
+     * Items are claimed one by one instead, re-checking bottom like `steal` does.
+     */
+    std::optional<T> first;
+    for (ptrdiff_t i = 0; i < (size + 1) / 2; ++i) {
+      if (i > 0) {
+        std::atomic_thread_fence(seq_cst);
+        if (static_cast<ptrdiff_t>(_bottom.load(acquire) - top) <= 0) {
+          break;
+        }
+      }
+
+      auto array = _buffer.get(relaxed);
+      T x(array->load(top, relaxed));
+      if (!_top.compare_exchange_strong(top, top + 1, seq_cst, relaxed)) {
+        /* race failed */
+        break;
+      }
+      ++top;
+
+      if (first) {
+        into.push(x);
+      }
+      else {
+        first.emplace(x);
+      }
+    }
+
+    return first;
+  }
+
   template<atom T>
   void chaselev<T>::push(const T x) {
     const auto bottom = _bottom.load(relaxed);
@@ -380,7 +540,7 @@ namespace ts {
 
     auto array = _buffer.get(relaxed);
     if (bottom - top >= array->size()) {
-      _buffer.resize(top, bottom);
+      _buffer.resize(top, bottom, array->size() * 2);
       array = _buffer.get(relaxed);
     }
 
@@ -406,6 +566,15 @@ namespace ts {
     return true;
   }
 
+  template<atom T>
+  void chaselev<T>::rehome() {
+    const auto bottom = _bottom.load(relaxed);
+    const auto top = _top.load(acquire);
+
+    // same protocol as growth in `push`; previous buffer is retired
+    _buffer.resize(top, bottom, _buffer.get(relaxed)->size());
+  }
+
   // to ignore IDE inspection
   namespace __ide {
     constexpr int _ = 0;
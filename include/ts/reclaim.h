@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace ts {
+  /**
+   * Epoch-based reclamation.
+   *
+   * Readers pin current epoch while they may hold pointers to shared objects.
+   * Object retired at epoch `e` can be freed once global epoch reaches `e + 2`;
+   * epoch only advances when every pinned thread has observed current one.
+   */
+  class epoch_domain {
+    struct record {
+      // (epoch << 1) | 1 while pinned; 0 otherwise
+      std::atomic_uint64_t state = 0;
+      std::atomic_flag used = ATOMIC_FLAG_INIT;
+      size_t depth = 0;
+      record *next = nullptr;
+    };
+
+    std::atomic_uint64_t _epoch = 1;
+    // records are never unlinked; those of exited threads are reused
+    std::atomic<record*> _records = nullptr;
+
+    record *acquire_record() {
+      for (auto r = _records.load(std::memory_order::acquire); r; r = r->next) {
+        if (!r->used.test(std::memory_order::relaxed) && !r->used.test_and_set(std::memory_order::acquire)) {
+          return r;
+        }
+      }
+
+      const auto r = new record();
+      r->used.test_and_set(std::memory_order::relaxed);
+      r->next = _records.load(std::memory_order::relaxed);
+      while (!_records.compare_exchange_weak(r->next, r, std::memory_order::release, std::memory_order::relaxed)) {
+      }
+      return r;
+    }
+
+    epoch_domain() = default;
+
+    record &local() {
+      thread_local struct holder {
+        epoch_domain &domain;
+        record *r;
+
+        explicit holder(epoch_domain &domain) : domain(domain), r(domain.acquire_record()) {
+        }
+
+        ~holder() {
+          r->used.clear(std::memory_order::release);
+        }
+      } holder(*this);
+
+      return *holder.r;
+    }
+
+  public:
+    class guard {
+      record *_record;
+
+    public:
+      explicit guard(record *record) noexcept : _record(record) {
+      }
+
+      guard(const guard &) = delete;
+      guard &operator=(const guard &) = delete;
+
+      ~guard() {
+        if (--_record->depth == 0) {
+          _record->state.store(0, std::memory_order::release);
+        }
+      }
+    };
+
+    epoch_domain(const epoch_domain &) = delete;
+    epoch_domain &operator=(const epoch_domain &) = delete;
+
+    ~epoch_domain() {
+      auto r = _records.load(std::memory_order::acquire);
+      while (r) {
+        delete std::exchange(r, r->next);
+      }
+    }
+
+    /**
+     * Domain shared by every deque; records of threads are bound to it.
+     */
+    static epoch_domain &global() {
+      static epoch_domain domain;
+      return domain;
+    }
+
+    /**
+     * Pins current epoch until returned guard is destroyed; nestable.
+     */
+    [[nodiscard]]
+    guard pin() {
+      auto &r = local();
+      if (r.depth++ == 0) {
+        r.state.store(_epoch.load(std::memory_order::relaxed) << 1 | 1, std::memory_order::relaxed);
+        // announcement must be visible before any shared pointer is read
+        std::atomic_thread_fence(std::memory_order::seq_cst);
+      }
+      return guard(&r);
+    }
+
+    [[nodiscard]]
+    uint64_t epoch() const noexcept {
+      return _epoch.load(std::memory_order::acquire);
+    }
+
+    /**
+     * Advances epoch if every pinned thread has observed current one.
+     *
+     * @return Current epoch after attempt.
+     */
+    uint64_t try_advance() {
+      std::atomic_thread_fence(std::memory_order::seq_cst);
+
+      auto epoch = _epoch.load(std::memory_order::acquire);
+      for (auto r = _records.load(std::memory_order::acquire); r; r = r->next) {
+        const auto state = r->state.load(std::memory_order::seq_cst);
+        if ((state & 1) && (state >> 1) != epoch) {
+          return epoch;
+        }
+      }
+
+      if (_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order::acq_rel)) {
+        return epoch + 1;
+      }
+      return epoch;
+    }
+
+    /**
+     * Whether object retired at `epoch` can no longer be reached by any reader.
+     */
+    [[nodiscard]]
+    bool reclaimable(const uint64_t epoch) const noexcept {
+      return this->epoch() >= epoch + 2;
+    }
+  };
+}
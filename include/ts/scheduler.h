@@ -1,5 +1,11 @@
 #pragma once
 
+#include <coroutine>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
 #include "worker.h"
 
 namespace ts {
@@ -16,51 +22,410 @@ namespace ts {
     size_t local_queue_size = 4096;
     size_t local_batch_size = 256;
     size_t global_queue_size = align(4096 * worker_count);
+    pin_policy pinning = pin_policy::none;
+    // submission entries of each worker's io_uring; 0 runs file I/O synchronously
+    uint32_t io_queue_depth = 256;
+    // extra workers that stand in for ones inside `scheduler::blocking`; threads start on first use
+    size_t spare_count = 2;
+    // external threads that may hold `producer` at once, and capacity of each one's feed
+    size_t producer_count = 16;
+    size_t producer_queue_size = 1024;
+  };
+
+  /**
+   * Submission handle of single external thread, backed by its own SPSC feed.
+   * Pushes take no atomic read-modify-write unless feed is full or job is high priority;
+   * those go through global queue.
+   */
+  class producer {
+    injector *_queue;
+    eventcount *_idle;
+    std::optional<size_t> _feed;
+
+  public:
+    producer(injector &queue, eventcount &idle) : _queue(&queue), _idle(&idle), _feed(queue.attach()) {
+    }
+
+    producer(producer &&other) noexcept
+      : _queue(other._queue),
+        _idle(other._idle),
+        _feed(std::exchange(other._feed, std::nullopt)) {
+    }
+
+    producer &operator=(producer &&other) noexcept {
+      if (this != &other) {
+        if (_feed) {
+          _queue->detach(*_feed);
+        }
+        _queue = other._queue;
+        _idle = other._idle;
+        _feed = std::exchange(other._feed, std::nullopt);
+      }
+      return *this;
+    }
+
+    producer(const producer &) = delete;
+    producer &operator=(const producer &) = delete;
+
+    ~producer() {
+      if (_feed) {
+        _queue->detach(*_feed);
+      }
+    }
+
+    /**
+     * Whether own feed was available; without it, pushes go through global queue.
+     */
+    [[nodiscard]] bool attached() const noexcept { return _feed.has_value(); }
+
+    void push(job *job) {
+      const auto fed = _feed && job->priority() != job_priority::high && _queue->push_feed(*_feed, job);
+      if (!fed && !_queue->push(job)) {
+        // only way to fail is push after `stop`
+#if NDEBUG
+        _queue->blocking_push(job);
+#else
+        const auto r = _queue->blocking_push(job);
+        assert(r);
+#endif
+      }
+
+      _idle->notify_one();
+    }
   };
 
   class scheduler {
     config _config;
+    injector _queue;
+    eventcount _idle;
+    timer_queue _timers;
+    io_reactor _io;
+    io_poller _poller;
+    trace_timebase _timebase;
     std::vector<std::unique_ptr<worker>> _workers;
-    vyukov<job*> _queue;
+
+    class schedule_awaiter {
+      scheduler &_scheduler;
+
+    public:
+      explicit schedule_awaiter(scheduler &scheduler) : _scheduler(scheduler) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      void await_suspend(const std::coroutine_handle<> h) const {
+        _scheduler.push(job::create([h](size_t) { h.resume(); }, {}, nullptr));
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+    void bind(const topology &topo) {
+      const auto count = _config.worker_count;
+      const auto cpus = topo.assign(_config.pinning, count);
+      if (cpus.empty()) {
+        return;
+      }
+
+      for (size_t i = 0; i < count; ++i) {
+        const auto &cpu = topo.cpus()[cpus[i]];
+
+        // spares float; they are looked at last
+        std::vector<std::vector<size_t>> victims(5);
+        for (size_t j = 0; j < _workers.size(); ++j) {
+          if (j >= count) {
+            victims[4].push_back(j);
+          }
+          else if (j != i) {
+            victims[static_cast<size_t>(cpu.distance(topo.cpus()[cpus[j]]))].push_back(j);
+          }
+        }
+        std::erase_if(victims, [](const auto &group) { return group.empty(); });
+
+        _workers[i]->bind(cpu.id, std::move(victims));
+      }
+    }
+
+    // new earliest timer; only keeper sleeps until deadline, and without one any parked worker takes over
+    void wake_keeper() {
+      if (const auto keeper = _timers.keeper()) {
+        _idle.notify_owner(keeper);
+        return;
+      }
+      _idle.notify_one();
+    }
 
   public:
-    explicit scheduler(const config &config) : _config(config), _queue(config.global_queue_size) {
-      _workers.reserve(config.worker_count);
-      for (size_t i = 0; i < config.worker_count; ++i) {
+    explicit scheduler(const config &config)
+      : _config(config),
+        _queue(config.global_queue_size, config.producer_count, config.producer_queue_size),
+        // spares may get rings too, so that I/O awaited during `blocking` doesn't block them as well
+        _io(config.worker_count + config.spare_count, config.io_queue_depth),
+        _poller(_idle) {
+      _workers.reserve(config.worker_count + config.spare_count);
+      for (size_t i = 0; i < config.worker_count + config.spare_count; ++i) {
         _workers.emplace_back(
           std::make_unique<worker>(
             _workers,
             _queue,
-            config.local_queue_size
+            _idle,
+            config.local_queue_size,
+            &_timers,
+            &_io,
+            _poller.valid() ? &_poller : nullptr
           ));
       }
+
+      for (size_t i = config.worker_count; i < _workers.size(); ++i) {
+        _workers[i]->retire();
+      }
+
+      if (config.pinning != pin_policy::none) {
+        bind(topology::detect());
+      }
     }
 
     [[nodiscard]] const config &config() const noexcept { return _config; }
 
+    /**
+     * Worker of this scheduler running calling thread; null elsewhere.
+     */
+    [[nodiscard]]
+    worker *current_worker() const noexcept {
+      const auto current = worker::current();
+      if (!current || current->id() >= _workers.size() || _workers[current->id()].get() != current) {
+        return nullptr;
+      }
+      return current;
+    }
+
+    /**
+     * Per-worker rings, spares included, behind `async_read` and the rest; buffers for fixed operations are registered here.
+     * Each ring is set up on its worker's first operation; failures show in `worker_stats::ring_fail`.
+     */
+    [[nodiscard]] io_reactor &io() noexcept { return _io; }
+
+    /**
+     * Epoll instance that `async_socket`s of this scheduler register with.
+     */
+    [[nodiscard]] io_poller &poller() noexcept { return _poller; }
+
     void push(job *job) {
       if (const auto current = worker::current()) {
         current->push(job);
         return;
       }
 
-      if (_queue.push(job)) {
+      if (!_queue.push(job)) {
+        // `blocking_push` cannot fail;
+        // only way to fail is call `push` after `stop`.
+#if NDEBUG
+        _queue.blocking_push(job);
+#else
+        const auto r = _queue.blocking_push(job);
+        assert(r);
+#endif
+      }
+
+      _idle.notify_one();
+    }
+
+    /**
+     * Registers calling thread as producer; handle must stay on that thread.
+     * Falls back to global queue if `config::producer_count` handles are held already.
+     */
+    [[nodiscard]]
+    producer attach() {
+      return producer(_queue, _idle);
+    }
+
+    /**
+     * Pushes job to mailbox of worker `id`, which looks there before its own deque.
+     * With `job_config::stealable` off, job and every range split from it run on that worker only.
+     */
+    void push_to(const size_t id, job *job) {
+      if (id >= _config.worker_count) {
+        throw std::out_of_range("No such worker");
+      }
+      _workers[id]->post(job);
+    }
+
+    /**
+     * Calls `f`, which may block its thread, e.g. in syscall or legacy client.
+     * Called from worker that leaves jobs behind or has no idle peer to take new ones,
+     * resumes spare worker for the duration of the call, like Go's handoff.
+     * Blocked worker's deque stays open to thieves.
+     */
+    template<typename F>
+    decltype(auto) blocking(F &&f) {
+      class spare_guard {
+        worker *_spare = nullptr;
+
+      public:
+        explicit spare_guard(scheduler &scheduler) {
+          const auto current = worker::current();
+          const auto &workers = scheduler._workers;
+          if (!current || current->id() >= workers.size() || workers[current->id()].get() != current) {
+            return;
+          }
+          if (!current->busy() && scheduler._idle.waiters() > 0) {
+            return;
+          }
+
+          for (size_t i = scheduler._config.worker_count; i < workers.size(); ++i) {
+            if (workers[i]->resume()) {
+              _spare = workers[i].get();
+              return;
+            }
+          }
+        }
+
+        spare_guard(const spare_guard &) = delete;
+        spare_guard &operator=(const spare_guard &) = delete;
+
+        ~spare_guard() {
+          if (_spare) {
+            _spare->retire();
+          }
+        }
+      };
+
+      const spare_guard guard(*this);
+      return std::forward<F>(f)();
+    }
+
+    /**
+     * Pushes jobs together.
+     * From outside workers, slots of global queue are reserved in bulk
+     * and sleeping workers are woken once for the whole batch.
+     */
+    void push_batch(const std::span<job* const> jobs) {
+      if (const auto current = worker::current()) {
+        current->push_batch(jobs);
         return;
       }
 
-      // `blocking_push` cannot fail;
-      // only way to fail is call `push` after `stop`.
+      size_t i = 0;
+      while (i < jobs.size()) {
+        if (const auto n = _queue.push_bulk(jobs.data() + i, jobs.size() - i)) {
+          _idle.notify(n);
+          i += n;
+          continue;
+        }
+
+        // queue is full; wait for single slot, then try bulk again
 #if NDEBUG
-      _queue.blocking_push(job);
+        _queue.blocking_push(jobs[i]);
 #else
-      const auto r = _queue.blocking_push(job);
-      assert(r);
+        const auto r = _queue.blocking_push(jobs[i]);
+        assert(r);
 #endif
+        _idle.notify_one();
+        i++;
+      }
     }
 
+    /**
+     * Snapshot of counters of each worker, indexed by worker id.
+     * Spares are only counted in `aggregate`.
+     */
     [[nodiscard]]
-    bool start() {
+    std::vector<worker_stats> stats() const {
+      std::vector<worker_stats> stats;
+      stats.reserve(_config.worker_count);
+      for (size_t i = 0; i < _config.worker_count; ++i) {
+        stats.push_back(_workers[i]->stats());
+      }
+      return stats;
+    }
+
+    /**
+     * Sum of counters of all workers, spares included.
+     */
+    [[nodiscard]]
+    worker_stats aggregate() const {
+      worker_stats total;
+      for (const auto &worker : _workers) {
+        total += worker->stats();
+      }
+      return total;
+    }
+
+    /**
+     * Writes trace of every worker as Chrome trace-event JSON,
+     * viewable in chrome://tracing or Perfetto.
+     * Records are only collected when built with `TS_TRACE`; call after `stop`.
+     */
+    void write_trace(std::ostream &out) const {
+      const auto ticks_per_us = _timebase.ticks_per_us();
+
+      bool first = true;
+      out << R"({"displayTimeUnit":"ns","traceEvents":[)";
       for (size_t i = 0; i < _workers.size(); ++i) {
+        write_trace_events(out, _workers[i]->trace(), i, _timebase, ticks_per_us, first);
+      }
+      out << "\n]}" << std::endl;
+    }
+
+    /**
+     * Pushes job once `when` has passed.
+     * Timers are fired by workers into their own deques; resolution is `TIMER_TICK`.
+     */
+    void push_at(const timer_clock::time_point when, job *job) {
+      if (_timers.add(when, {0, job, nullptr})) {
+        wake_keeper();
+      }
+    }
+
+    void push_after(const timer_clock::duration delay, job *job) {
+      push_at(timer_clock::now() + delay, job);
+    }
+
+    /**
+     * Pushes job of `callback` with `config` every `period`, first one after a period.
+     * Missed periods are skipped; stops once returned handle is cancelled.
+     * Timer owns its cancellation, so `config.cancel` must be empty.
+     */
+    template<typename F>
+    timer_handle push_every(const timer_clock::duration period, F &&callback, const job_config &config = {}) {
+      if (config.cancel) {
+        throw std::invalid_argument("Periodic timer is cancelled through its handle");
+      }
+
+      const auto ticks = std::max<uint64_t>(1, (period + TIMER_TICK - timer_clock::duration(1)) / TIMER_TICK);
+      auto periodic = std::make_shared<timer_wheel::periodic>(std::forward<F>(callback), config, ticks);
+      timer_handle handle(periodic);
+
+      if (_timers.add(timer_clock::now() + period, {0, nullptr, std::move(periodic)})) {
+        wake_keeper();
+      }
+      return handle;
+    }
+
+    /**
+     * Pushes job and returns its completion handle.
+     */
+    [[nodiscard]]
+    handle submit(job *job) {
+      auto handle = job->watch();
+      push(job);
+      return handle;
+    }
+
+    /**
+     * Awaitable to continue awaiting coroutine on workers.
+     * From worker, continuation goes to its local deque; otherwise to global queue.
+     */
+    [[nodiscard]]
+    schedule_awaiter schedule() noexcept {
+      return schedule_awaiter(*this);
+    }
+
+    [[nodiscard]]
+    bool start() {
+      // spares are started by `blocking`
+      for (size_t i = 0; i < _config.worker_count; ++i) {
         if (!_workers[i]->start()) {
           _queue.kill();
 
@@ -85,10 +450,32 @@ namespace ts {
       }
 
       if (flush) {
+        std::vector<job*> ready;
+        const auto spawn = [&ready](job *job) { ready.push_back(job); };
+
+        const auto drain = [&ready, &spawn] {
+          while (!ready.empty()) {
+            std::optional next = ready.back();
+            ready.pop_back();
+
+            do {
+              next = next.value()->call(spawn);
+            } while (next);
+          }
+        };
+
+        // pending one-shot timers run now; periodic ones are dropped
+        _timers.clear(spawn);
+        drain();
+
         while (auto opt = _queue.pop()) {
-          do {
-            opt = opt.value()->call();
-          } while (opt);
+          ready.push_back(opt.value());
+          drain();
+        }
+
+        for (const auto &worker : _workers) {
+          worker->drain_mailbox(spawn);
+          drain();
         }
       }
 
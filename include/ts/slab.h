@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "queue.h"
+
+namespace ts {
+  // slots allocated together when heap runs dry
+  constexpr size_t SLAB_CHUNK_SIZE = 64;
+  // default cap of slots cached by each thread
+  constexpr size_t SLAB_DEFAULT_LIMIT = 1024 * 16;
+
+  /**
+   * Slab allocator with per-thread heaps.
+   *
+   * Object is always returned to heap of thread that allocated it:
+   * locally by owner, or through lock-free remote list by any other thread,
+   * which owner drains once its local list runs dry.
+   * Heap outlives its thread until every object of it has come back.
+   *
+   * Slots are cache-line aligned. Once thread caches `limit()` slots,
+   * further objects go to global allocator and are freed on return.
+   */
+  template<typename T>
+  class slab {
+    class heap;
+
+    // held in balance of heap while its thread lives, so that remote frees can't bring it to zero
+    static constexpr int64_t OWNED = int64_t(1) << 62;
+
+    struct slot {
+      alignas(std::max(alignof(T), CACHELINE_SIZE)) std::byte storage[sizeof(T)];
+      // null if slot is not from any heap
+      heap *owner;
+      slot *next;
+    };
+
+    class heap {
+      // owner only
+      slot *_free = nullptr;
+      size_t _capacity = 0;
+      // slots handed out and not yet back in `_free`
+      size_t _live = 0;
+      std::vector<std::unique_ptr<slot[]>> _chunks;
+
+      alignas(CACHELINE_SIZE) std::atomic<slot*> _remote = nullptr;
+      /*
+       * While owned: `OWNED` minus slots pushed to `_remote` and not yet collected.
+       * After thread exits: slots still out; whoever brings it to zero deletes heap.
+       */
+      std::atomic_int64_t _balance = OWNED;
+
+      void collect() {
+        auto list = _remote.exchange(nullptr, std::memory_order::acquire);
+        if (!list) {
+          return;
+        }
+
+        int64_t n = 0;
+        while (list) {
+          const auto s = std::exchange(list, list->next);
+          s->next = _free;
+          _free = s;
+          n++;
+        }
+
+        _live -= n;
+        _balance.fetch_add(n, std::memory_order::relaxed);
+      }
+
+      void grow() {
+        if (_capacity + SLAB_CHUNK_SIZE > _limit.load(std::memory_order::relaxed)) {
+          return;
+        }
+
+        auto chunk = std::make_unique<slot[]>(SLAB_CHUNK_SIZE);
+        for (size_t i = 0; i < SLAB_CHUNK_SIZE; ++i) {
+          chunk[i].owner = this;
+          chunk[i].next = _free;
+          _free = &chunk[i];
+        }
+
+        _chunks.push_back(std::move(chunk));
+        _capacity += SLAB_CHUNK_SIZE;
+      }
+
+    public:
+      [[nodiscard]]
+      slot *acquire() {
+        if (!_free) {
+          collect();
+        }
+        if (!_free) {
+          grow();
+        }
+        if (!_free) {
+          return nullptr;
+        }
+
+        _live++;
+        return std::exchange(_free, _free->next);
+      }
+
+      void release_local(slot *s) {
+        s->next = _free;
+        _free = s;
+        _live--;
+      }
+
+      void release_remote(slot *s) {
+        s->next = _remote.load(std::memory_order::relaxed);
+        while (!_remote.compare_exchange_weak(s->next, s, std::memory_order::release, std::memory_order::relaxed)) {
+        }
+
+        if (_balance.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+          delete this;
+        }
+      }
+
+      // called once by owner on thread exit
+      void abandon() {
+        collect();
+
+        const auto change = static_cast<int64_t>(_live) - OWNED;
+        if (_balance.fetch_add(change, std::memory_order::acq_rel) + change == 0) {
+          delete this;
+        }
+      }
+
+      [[nodiscard]] size_t capacity() const noexcept { return _capacity; }
+    };
+
+    static inline std::atomic_size_t _limit = SLAB_DEFAULT_LIMIT;
+
+    static heap *local() {
+      thread_local heap *current = nullptr;
+      thread_local bool exited = false;
+
+      if (!current && !exited) {
+        current = new heap();
+
+        thread_local struct guard {
+          ~guard() {
+            exited = true;
+            std::exchange(current, nullptr)->abandon();
+          }
+        } guard;
+      }
+
+      return current;
+    }
+
+    static void release(slot *s) {
+      const auto owner = s->owner;
+      if (!owner) {
+        delete s;
+      }
+      else if (owner == local()) {
+        owner->release_local(s);
+      }
+      else {
+        owner->release_remote(s);
+      }
+    }
+
+  public:
+    template<typename... Args>
+    static T *rent(Args &&... args) {
+      const auto h = local();
+
+      auto s = h ? h->acquire() : nullptr;
+      if (!s) {
+        s = new slot;
+        s->owner = nullptr;
+      }
+
+      try {
+        return new(s->storage) T(std::forward<Args>(args)...);
+      }
+      catch (...) {
+        release(s);
+        throw;
+      }
+    }
+
+    static void yield(T *p) {
+      assert(p != nullptr);
+
+      p->~T();
+      release(reinterpret_cast<slot*>(p));
+    }
+
+    /**
+     * Caps slots each thread caches; applies to heaps when they next grow.
+     */
+    static void limit(const size_t slots) noexcept {
+      _limit.store(slots, std::memory_order::relaxed);
+    }
+
+    [[nodiscard]]
+    static size_t limit() noexcept {
+      return _limit.load(std::memory_order::relaxed);
+    }
+
+    /**
+     * Slots cached by calling thread.
+     */
+    [[nodiscard]]
+    static size_t capacity() {
+      const auto h = local();
+      return h ? h->capacity() : 0;
+    }
+  };
+}
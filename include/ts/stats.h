@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "queue.h"
+
+namespace ts {
+  /**
+   * Snapshot of counters of single worker (or sum of several).
+   */
+  struct worker_stats {
+    // jobs taken from own deque
+    uint64_t local = 0;
+    // successful steals from other workers' deques
+    uint64_t steal = 0;
+    // jobs popped from global queue
+    uint64_t global = 0;
+    // idle iterations spent in each backoff stage
+    uint64_t spin = 0;
+    uint64_t yield = 0;
+    uint64_t park = 0;
+    // ranges split off by `chunk`
+    uint64_t split = 0;
+    // pieces called
+    uint64_t run = 0;
+    // io_uring setups that failed; worker's I/O then runs synchronously
+    uint64_t ring_fail = 0;
+
+    worker_stats &operator+=(const worker_stats &other) noexcept {
+      local += other.local;
+      steal += other.steal;
+      global += other.global;
+      spin += other.spin;
+      yield += other.yield;
+      park += other.park;
+      split += other.split;
+      run += other.run;
+      ring_fail += other.ring_fail;
+      return *this;
+    }
+  };
+
+  /**
+   * Counters written only by owning worker.
+   * Increment is plain load and store; readers may see slightly stale values.
+   */
+  class alignas(CACHELINE_SIZE) worker_counters {
+    std::atomic_uint64_t _local = 0;
+    std::atomic_uint64_t _steal = 0;
+    std::atomic_uint64_t _global = 0;
+    std::atomic_uint64_t _spin = 0;
+    std::atomic_uint64_t _yield = 0;
+    std::atomic_uint64_t _park = 0;
+    std::atomic_uint64_t _split = 0;
+    std::atomic_uint64_t _run = 0;
+    std::atomic_uint64_t _ring_fail = 0;
+
+    static void bump(std::atomic_uint64_t &counter) noexcept {
+      counter.store(counter.load(std::memory_order::relaxed) + 1, std::memory_order::relaxed);
+    }
+
+  public:
+    void local() noexcept { bump(_local); }
+    void steal() noexcept { bump(_steal); }
+    void global() noexcept { bump(_global); }
+    void spin() noexcept { bump(_spin); }
+    void yield() noexcept { bump(_yield); }
+    void park() noexcept { bump(_park); }
+    void split() noexcept { bump(_split); }
+    void run() noexcept { bump(_run); }
+    void ring_fail() noexcept { bump(_ring_fail); }
+
+    [[nodiscard]]
+    worker_stats snapshot() const noexcept {
+      return {
+        _local.load(std::memory_order::relaxed),
+        _steal.load(std::memory_order::relaxed),
+        _global.load(std::memory_order::relaxed),
+        _spin.load(std::memory_order::relaxed),
+        _yield.load(std::memory_order::relaxed),
+        _park.load(std::memory_order::relaxed),
+        _split.load(std::memory_order::relaxed),
+        _run.load(std::memory_order::relaxed),
+        _ring_fail.load(std::memory_order::relaxed),
+      };
+    }
+  };
+
+  /**
+   * Formats per-worker stats in Prometheus text exposition format.
+   * Each counter is one metric family labelled by worker index.
+   */
+  inline std::string to_prometheus(const std::span<const worker_stats> stats) {
+    struct family {
+      const char *name;
+      const char *help;
+      uint64_t worker_stats::*field;
+    };
+
+    static constexpr family FAMILIES[] = {
+      { "tasksys_local_takes_total", "Jobs taken from own deque.", &worker_stats::local },
+      { "tasksys_steals_total", "Successful steals from other workers.", &worker_stats::steal },
+      { "tasksys_global_pops_total", "Jobs popped from global queue.", &worker_stats::global },
+      { "tasksys_spins_total", "Idle iterations spent spinning.", &worker_stats::spin },
+      { "tasksys_yields_total", "Idle iterations spent yielding.", &worker_stats::yield },
+      { "tasksys_parks_total", "Times worker parked.", &worker_stats::park },
+      { "tasksys_splits_total", "Ranges split off by chunking.", &worker_stats::split },
+      { "tasksys_runs_total", "Job pieces called.", &worker_stats::run },
+      { "tasksys_ring_failures_total", "Failed io_uring setups.", &worker_stats::ring_fail },
+    };
+
+    std::string out;
+    for (const auto &[name, help, field] : FAMILIES) {
+      out += "# HELP ";
+      out += name;
+      out += ' ';
+      out += help;
+      out += "\n# TYPE ";
+      out += name;
+      out += " counter\n";
+
+      for (size_t i = 0; i < stats.size(); ++i) {
+        out += name;
+        out += "{worker=\"";
+        out += std::to_string(i);
+        out += "\"} ";
+        out += std::to_string(stats[i].*field);
+        out += '\n';
+      }
+    }
+
+    return out;
+  }
+}
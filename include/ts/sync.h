@@ -0,0 +1,437 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+#include "task.h"
+
+namespace ts {
+  /**
+   * Resumes coroutine released by another one.
+   * On worker it goes to releasing worker's deque, so it runs there next unless stolen;
+   * off workers it runs inline.
+   */
+  inline void resume_waiter(const std::coroutine_handle<> h) {
+    if (const auto current = worker::current()) {
+      current->push(job::create([h](size_t) { h.resume(); }, {}, nullptr));
+      return;
+    }
+    h.resume();
+  }
+
+  // suspended coroutine linked into waiter list of primitive
+  struct sync_waiter {
+    std::coroutine_handle<> handle;
+    sync_waiter *next = nullptr;
+  };
+
+  class async_mutex;
+
+  /**
+   * Owns lock of `async_mutex`; unlocks on destruction.
+   */
+  class async_lock {
+    async_mutex *_mutex;
+
+  public:
+    explicit async_lock(async_mutex &mutex) noexcept : _mutex(&mutex) {
+    }
+
+    async_lock(async_lock &&other) noexcept : _mutex(std::exchange(other._mutex, nullptr)) {
+    }
+
+    async_lock &operator=(async_lock &&) = delete;
+    async_lock(const async_lock &) = delete;
+    async_lock &operator=(const async_lock &) = delete;
+
+    ~async_lock();
+  };
+
+  /**
+   * Mutex that suspends contending coroutine instead of its thread.
+   *
+   * Lock-free: state is unlocked, locked, or stack of waiters pushed since holder last looked.
+   * Holder reverses that stack into FIFO list, and `unlock` hands lock straight to its head.
+   */
+  class async_mutex {
+    static inline const auto UNLOCKED = reinterpret_cast<void*>(1);
+
+    std::atomic<void*> _state = UNLOCKED;
+    // holder only; oldest first
+    sync_waiter *_waiters = nullptr;
+
+    class lock_awaiter : sync_waiter {
+      async_mutex &_mutex;
+
+    public:
+      explicit lock_awaiter(async_mutex &mutex) noexcept : _mutex(mutex) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(const std::coroutine_handle<> h) noexcept {
+        handle = h;
+
+        auto state = _mutex._state.load(std::memory_order::relaxed);
+        for (;;) {
+          if (state == UNLOCKED) {
+            if (_mutex._state.compare_exchange_weak(state, nullptr, std::memory_order::acquire)) {
+              return false;
+            }
+            continue;
+          }
+
+          next = static_cast<sync_waiter*>(state);
+          if (_mutex._state.compare_exchange_weak(state, static_cast<sync_waiter*>(this), std::memory_order::release)) {
+            return true;
+          }
+        }
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+    class scoped_awaiter {
+      async_mutex &_mutex;
+      lock_awaiter _awaiter;
+
+    public:
+      explicit scoped_awaiter(async_mutex &mutex) noexcept : _mutex(mutex), _awaiter(mutex) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(const std::coroutine_handle<> h) noexcept {
+        return _awaiter.await_suspend(h);
+      }
+
+      [[nodiscard]]
+      async_lock await_resume() const noexcept {
+        return async_lock(_mutex);
+      }
+    };
+
+  public:
+    async_mutex() = default;
+
+    async_mutex(const async_mutex &) = delete;
+    async_mutex &operator=(const async_mutex &) = delete;
+
+    [[nodiscard]]
+    bool try_lock() noexcept {
+      auto expected = UNLOCKED;
+      return _state.compare_exchange_strong(expected, nullptr, std::memory_order::acquire);
+    }
+
+    /**
+     * Awaitable acquiring lock; release with `unlock`.
+     */
+    [[nodiscard]]
+    lock_awaiter lock() noexcept {
+      return lock_awaiter(*this);
+    }
+
+    /**
+     * Awaitable acquiring lock as `async_lock`.
+     */
+    [[nodiscard]]
+    scoped_awaiter scoped_lock() noexcept {
+      return scoped_awaiter(*this);
+    }
+
+    /**
+     * Hands lock to oldest waiter if any; holder only.
+     */
+    void unlock() {
+      auto head = _waiters;
+      if (!head) {
+        void *expected = nullptr;
+        if (_state.compare_exchange_strong(expected, UNLOCKED, std::memory_order::release)) {
+          return;
+        }
+
+        // waiters came in; take them all, oldest first
+        auto list = static_cast<sync_waiter*>(_state.exchange(nullptr, std::memory_order::acquire));
+        while (list) {
+          const auto next = list->next;
+          list->next = head;
+          head = list;
+          list = next;
+        }
+      }
+
+      _waiters = head->next;
+      resume_waiter(head->handle);
+    }
+  };
+
+  inline async_lock::~async_lock() {
+    if (_mutex) {
+      _mutex->unlock();
+    }
+  }
+
+  /**
+   * Counting semaphore that suspends coroutine while count is zero.
+   * Released units go to waiters in arrival order before count grows.
+   */
+  class async_semaphore {
+    std::atomic_ptrdiff_t _count;
+
+    // guards waiter list; held only to link or unlink
+    std::mutex _mutex;
+    sync_waiter *_head = nullptr;
+    sync_waiter *_tail = nullptr;
+
+    bool try_take() noexcept {
+      auto count = _count.load(std::memory_order::relaxed);
+      while (count > 0) {
+        if (_count.compare_exchange_weak(count, count - 1, std::memory_order::acquire)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    class acquire_awaiter : sync_waiter {
+      async_semaphore &_semaphore;
+
+    public:
+      explicit acquire_awaiter(async_semaphore &semaphore) noexcept : _semaphore(semaphore) {
+      }
+
+      [[nodiscard]]
+      bool await_ready() const noexcept {
+        return _semaphore.try_take();
+      }
+
+      bool await_suspend(const std::coroutine_handle<> h) {
+        handle = h;
+
+        std::lock_guard lock(_semaphore._mutex);
+        // `release` raises count only under lock while nobody waits
+        if (_semaphore.try_take()) {
+          return false;
+        }
+
+        if (_semaphore._tail) {
+          _semaphore._tail->next = this;
+        }
+        else {
+          _semaphore._head = this;
+        }
+        _semaphore._tail = this;
+        return true;
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+  public:
+    explicit async_semaphore(const ptrdiff_t count) : _count(count) {
+    }
+
+    async_semaphore(const async_semaphore &) = delete;
+    async_semaphore &operator=(const async_semaphore &) = delete;
+
+    [[nodiscard]]
+    bool try_acquire() noexcept {
+      return try_take();
+    }
+
+    [[nodiscard]]
+    acquire_awaiter acquire() noexcept {
+      return acquire_awaiter(*this);
+    }
+
+    void release(ptrdiff_t n = 1) {
+      sync_waiter *ready = nullptr;
+      sync_waiter **last = &ready;
+      {
+        std::lock_guard lock(_mutex);
+        while (n > 0 && _head) {
+          *last = std::exchange(_head, _head->next);
+          last = &(*last)->next;
+          n--;
+        }
+        *last = nullptr;
+        if (!_head) {
+          _tail = nullptr;
+        }
+
+        if (n > 0) {
+          _count.fetch_add(n, std::memory_order::release);
+        }
+      }
+
+      while (ready) {
+        // waiter may be gone once resumed
+        const auto next = ready->next;
+        resume_waiter(ready->handle);
+        ready = next;
+      }
+    }
+  };
+
+  /**
+   * Single-use countdown; coroutines awaiting it resume once it reaches zero.
+   */
+  class async_latch {
+    static inline const auto OPEN = reinterpret_cast<void*>(1);
+
+    std::atomic_ptrdiff_t _count;
+    // stack of waiters; `OPEN` once count reached zero
+    std::atomic<void*> _waiters = nullptr;
+
+    class awaiter : sync_waiter {
+      async_latch &_latch;
+
+    public:
+      explicit awaiter(async_latch &latch) noexcept : _latch(latch) {
+      }
+
+      [[nodiscard]]
+      bool await_ready() const noexcept {
+        return _latch.ready();
+      }
+
+      bool await_suspend(const std::coroutine_handle<> h) noexcept {
+        handle = h;
+
+        auto state = _latch._waiters.load(std::memory_order::acquire);
+        do {
+          if (state == OPEN) {
+            return false;
+          }
+          next = static_cast<sync_waiter*>(state);
+        } while (!_latch._waiters.compare_exchange_weak(
+          state, static_cast<sync_waiter*>(this), std::memory_order::acq_rel, std::memory_order::acquire));
+
+        return true;
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+  public:
+    explicit async_latch(const ptrdiff_t count) : _count(count) {
+      if (count <= 0) {
+        _waiters.store(OPEN, std::memory_order::relaxed);
+      }
+    }
+
+    async_latch(const async_latch &) = delete;
+    async_latch &operator=(const async_latch &) = delete;
+
+    [[nodiscard]]
+    bool ready() const noexcept {
+      return _waiters.load(std::memory_order::acquire) == OPEN;
+    }
+
+    void count_down(const ptrdiff_t n = 1) {
+      if (_count.fetch_sub(n, std::memory_order::acq_rel) != n) {
+        return;
+      }
+
+      auto list = static_cast<sync_waiter*>(_waiters.exchange(OPEN, std::memory_order::acq_rel));
+      _waiters.notify_all();
+      while (list) {
+        const auto next = list->next;
+        resume_waiter(list->handle);
+        list = next;
+      }
+    }
+
+    [[nodiscard]]
+    awaiter operator co_await() noexcept {
+      return awaiter(*this);
+    }
+
+    /**
+     * Waits from plain job or thread.
+     * On worker, keeps running other jobs instead of blocking its thread.
+     */
+    void wait() const {
+      if (const auto current = worker::current()) {
+        current->run_until([this] { return ready(); });
+        return;
+      }
+
+      for (auto state = _waiters.load(std::memory_order::acquire); state != OPEN;
+           state = _waiters.load(std::memory_order::acquire)) {
+        _waiters.wait(state, std::memory_order::acquire);
+      }
+    }
+  };
+
+  /**
+   * Reusable barrier for fixed number of coroutines.
+   * Last one to arrive in each phase resumes the others and goes on without suspending.
+   */
+  class async_barrier {
+    const size_t _expected;
+
+    // guards phase state; held only to link waiter or open phase
+    std::mutex _mutex;
+    size_t _arrived = 0;
+    sync_waiter *_waiters = nullptr;
+
+    class awaiter : sync_waiter {
+      async_barrier &_barrier;
+
+    public:
+      explicit awaiter(async_barrier &barrier) noexcept : _barrier(barrier) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(const std::coroutine_handle<> h) {
+        handle = h;
+
+        sync_waiter *list;
+        {
+          std::lock_guard lock(_barrier._mutex);
+          if (++_barrier._arrived < _barrier._expected) {
+            next = _barrier._waiters;
+            _barrier._waiters = this;
+            return true;
+          }
+
+          list = std::exchange(_barrier._waiters, nullptr);
+          _barrier._arrived = 0;
+        }
+
+        while (list) {
+          const auto next = list->next;
+          resume_waiter(list->handle);
+          list = next;
+        }
+        return false;
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+  public:
+    explicit async_barrier(const size_t expected) : _expected(expected) {
+    }
+
+    async_barrier(const async_barrier &) = delete;
+    async_barrier &operator=(const async_barrier &) = delete;
+
+    /**
+     * Arrives and waits for the rest of current phase.
+     */
+    [[nodiscard]]
+    awaiter arrive_and_wait() noexcept {
+      return awaiter(*this);
+    }
+  };
+}
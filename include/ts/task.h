@@ -0,0 +1,475 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "scheduler.h"
+
+namespace ts {
+  template<typename T = void>
+  class task;
+
+  class fork_scope;
+
+  class promise_base {
+    std::coroutine_handle<> _continuation = std::noop_coroutine();
+    std::exception_ptr _exception;
+
+    // set while task runs as child spawned into scope
+    fork_scope *_scope = nullptr;
+    // job resuming awaiter elsewhere; sits in spawning worker's deque
+    job *_resumer = nullptr;
+    // set by whichever of child and resumer finishes first
+    std::atomic_flag _joined = ATOMIC_FLAG_INIT;
+    bool _reclaimed = false;
+
+    friend class fork_scope;
+
+    // awaiter to transfer to once done
+    std::coroutine_handle<> complete() noexcept;
+
+    // body of `_resumer`; resumes awaiter on thief
+    void resume();
+
+    struct final_awaiter {
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      // symmetric transfer; resuming awaiter doesn't grow stack
+      template<typename P>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+        return h.promise().complete();
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+  public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() noexcept {
+      _exception = std::current_exception();
+    }
+
+    void continuation(const std::coroutine_handle<> h) noexcept {
+      _continuation = h;
+    }
+
+    void rethrow() const {
+      if (_exception) {
+        std::rethrow_exception(_exception);
+      }
+    }
+  };
+
+  template<typename T>
+  class promise : public promise_base {
+    std::optional<T> _value;
+
+  public:
+    task<T> get_return_object() noexcept;
+
+    template<typename U = T>
+    void return_value(U &&value) {
+      _value.emplace(std::forward<U>(value));
+    }
+
+    T result() {
+      rethrow();
+      return std::move(_value.value());
+    }
+  };
+
+  template<>
+  class promise<void> : public promise_base {
+  public:
+    task<> get_return_object() noexcept;
+
+    void return_void() const noexcept {
+    }
+
+    void result() const {
+      rethrow();
+    }
+  };
+
+  /**
+   * Lazily started coroutine.
+   * Body runs when awaited; awaiter is resumed by symmetric transfer on completion.
+   */
+  template<typename T>
+  class [[nodiscard]] task {
+  public:
+    using promise_type = promise<T>;
+
+  private:
+    std::coroutine_handle<promise_type> _handle;
+
+    friend class fork_scope;
+
+    struct awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      [[nodiscard]] bool await_ready() const noexcept {
+        return !handle || handle.done();
+      }
+
+      std::coroutine_handle<> await_suspend(const std::coroutine_handle<> caller) noexcept {
+        handle.promise().continuation(caller);
+        return handle;
+      }
+
+      T await_resume() {
+        return handle.promise().result();
+      }
+    };
+
+  public:
+    task() noexcept : _handle(nullptr) {
+    }
+
+    explicit task(const std::coroutine_handle<promise_type> handle) noexcept : _handle(handle) {
+    }
+
+    task(task &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {
+    }
+
+    task &operator=(task &&other) noexcept {
+      if (this != &other) {
+        if (_handle) {
+          _handle.destroy();
+        }
+        _handle = std::exchange(other._handle, nullptr);
+      }
+      return *this;
+    }
+
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    ~task() {
+      if (_handle) {
+        _handle.destroy();
+      }
+    }
+
+    [[nodiscard]]
+    bool done() const noexcept {
+      return !_handle || _handle.done();
+    }
+
+    awaiter operator co_await() & noexcept {
+      return awaiter{_handle};
+    }
+
+    awaiter operator co_await() && noexcept {
+      return awaiter{_handle};
+    }
+  };
+
+  template<typename T>
+  task<T> promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<promise>::from_promise(*this));
+  }
+
+  inline task<> promise<void>::get_return_object() noexcept {
+    return task<>(std::coroutine_handle<promise>::from_promise(*this));
+  }
+
+  /**
+   * Fork-join scope of coroutine, after Cilk's `spawn` and `sync`.
+   *
+   * `co_await scope.spawn(child)` leaves continuation of awaiting coroutine in worker's deque
+   * and runs child inline (work-first). If nobody stole continuation by the time child completes,
+   * child takes it back and resumes awaiter directly, so unstolen spawn costs little more than call.
+   * Otherwise thief resumes awaiter, and `co_await scope.sync()` suspends until stolen children complete;
+   * it never suspends if no continuation was stolen.
+   *
+   * Every spawned child must be synced before scope or child is destroyed.
+   * Off workers, spawn just awaits child.
+   */
+  class fork_scope {
+    // outstanding children with stolen continuation, plus one held until sync
+    std::atomic_size_t _pending = 1;
+    std::coroutine_handle<> _waiter;
+
+    template<typename T>
+    class spawn_awaiter {
+      fork_scope &_scope;
+      std::coroutine_handle<promise<T>> _child;
+
+    public:
+      spawn_awaiter(fork_scope &scope, const std::coroutine_handle<promise<T>> child) noexcept
+        : _scope(scope), _child(child) {
+      }
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(const std::coroutine_handle<> parent) {
+        const auto child = _child;
+        promise_base &state = child.promise();
+        state.continuation(parent);
+
+        const auto current = worker::current();
+        if (!current) {
+          return child;
+        }
+
+        state._scope = &_scope;
+        state._resumer = job::create([&state](size_t) { state.resume(); }, {}, nullptr);
+
+        // awaiter may resume on thief from here on; nothing of it is touched
+        current->push(state._resumer);
+        return child;
+      }
+
+      void await_resume() const noexcept {
+      }
+    };
+
+    class sync_awaiter {
+      fork_scope &_scope;
+
+    public:
+      explicit sync_awaiter(fork_scope &scope) noexcept : _scope(scope) {
+      }
+
+      [[nodiscard]]
+      bool await_ready() const noexcept {
+        return _scope._pending.load(std::memory_order::acquire) == 1;
+      }
+
+      bool await_suspend(const std::coroutine_handle<> h) noexcept {
+        _scope._waiter = h;
+        // last child may have arrived meanwhile
+        return _scope._pending.fetch_sub(1, std::memory_order::acq_rel) != 1;
+      }
+
+      void await_resume() const noexcept {
+        _scope._pending.store(1, std::memory_order::relaxed);
+      }
+    };
+
+    // called by stolen child once done
+    std::coroutine_handle<> arrive() noexcept {
+      if (_pending.fetch_sub(1, std::memory_order::acq_rel) == 1) {
+        return _waiter;
+      }
+      return std::noop_coroutine();
+    }
+
+    friend class promise_base;
+
+  public:
+    fork_scope() = default;
+
+    fork_scope(const fork_scope &) = delete;
+    fork_scope &operator=(const fork_scope &) = delete;
+
+    ~fork_scope() {
+      assert(_pending.load(std::memory_order::relaxed) == 1);
+    }
+
+    /**
+     * Runs `child` inline, offering rest of awaiting coroutine to thieves.
+     * Result is taken by awaiting `child` after `sync`.
+     */
+    template<typename T>
+    [[nodiscard]]
+    spawn_awaiter<T> spawn(task<T> &child) noexcept {
+      return {*this, child._handle};
+    }
+
+    /**
+     * Waits for every child spawned since last sync.
+     */
+    [[nodiscard]]
+    sync_awaiter sync() noexcept {
+      return sync_awaiter(*this);
+    }
+  };
+
+  inline std::coroutine_handle<> promise_base::complete() noexcept {
+    if (!_scope) {
+      return _continuation;
+    }
+
+    // continuation is still ours; drop its job and resume awaiter right here
+    if (const auto current = worker::current(); current && current->take_back(_resumer)) {
+      _reclaimed = true;
+      (void) _resumer->call([](job *) {});
+      return _continuation;
+    }
+
+    // resumer has run; awaiter counted us as pending
+    const auto scope = _scope;
+    if (_joined.test_and_set(std::memory_order::acq_rel)) {
+      return scope->arrive();
+    }
+    return std::noop_coroutine();
+  }
+
+  inline void promise_base::resume() {
+    if (_reclaimed) {
+      return;
+    }
+
+    const auto scope = _scope;
+    const auto parent = _continuation;
+
+    // child may be gone once joined; read everything first
+    scope->_pending.fetch_add(1, std::memory_order::relaxed);
+    if (_joined.test_and_set(std::memory_order::acq_rel)) {
+      // child completed first; nothing to wait for
+      scope->_pending.fetch_sub(1, std::memory_order::relaxed);
+    }
+    parent.resume();
+  }
+
+  /**
+   * Coroutine to block non-coroutine context until awaited task completes.
+   */
+  class blocker {
+  public:
+    /**
+     * Completion flag living on waiter's stack.
+     * Set and notified under lock that waiter takes before returning,
+     * so signaller is done with it by the time it goes away.
+     */
+    class signal {
+      std::mutex _mutex;
+      std::condition_variable _cv;
+      std::atomic_bool _done = false;
+
+    public:
+      void set() {
+        std::lock_guard lock(_mutex);
+        _done.store(true, release);
+        _cv.notify_all();
+      }
+
+      [[nodiscard]]
+      bool test() const noexcept {
+        return _done.load(acquire);
+      }
+
+      void wait() {
+        std::unique_lock lock(_mutex);
+        _cv.wait(lock, [this] { return test(); });
+      }
+    };
+
+    struct promise_type {
+      signal *done = nullptr;
+
+      blocker get_return_object() noexcept {
+        return blocker(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() const noexcept { return {}; }
+
+      auto final_suspend() const noexcept {
+        struct awaiter {
+          [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+          void await_suspend(const std::coroutine_handle<promise_type> h) const noexcept {
+            h.promise().done->set();
+          }
+
+          void await_resume() const noexcept {
+          }
+        };
+        return awaiter{};
+      }
+
+      void return_void() const noexcept {
+      }
+
+      // exceptions are stored in awaited task; nothing reaches here
+      void unhandled_exception() const noexcept {
+        std::terminate();
+      }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> _handle;
+
+  public:
+    explicit blocker(const std::coroutine_handle<promise_type> handle) : _handle(handle) {
+    }
+
+    blocker(const blocker &) = delete;
+    blocker &operator=(const blocker &) = delete;
+
+    ~blocker() {
+      _handle.destroy();
+    }
+
+    void run(signal &done) const {
+      _handle.promise().done = &done;
+      _handle.resume();
+
+      if (const auto current = worker::current()) {
+        current->run_until([&done] { return done.test(); });
+      }
+
+      // also waits out signaller still holding lock
+      done.wait();
+    }
+  };
+
+  /**
+   * Runs task to completion, blocking calling thread.
+   * Task starts on calling thread and moves to workers when it awaits `scheduler::schedule`.
+   * On worker, other jobs keep running while waiting.
+   */
+  template<typename T>
+  T sync_wait(task<T> task) {
+    std::optional<T> result;
+    std::exception_ptr exception;
+
+    auto body = [](ts::task<T> &task, std::optional<T> &result, std::exception_ptr &exception) -> blocker {
+      try {
+        result.emplace(co_await task);
+      }
+      catch (...) {
+        exception = std::current_exception();
+      }
+    };
+
+    blocker::signal done;
+    body(task, result, exception).run(done);
+
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+    return std::move(result.value());
+  }
+
+  inline void sync_wait(task<> task) {
+    std::exception_ptr exception;
+
+    auto body = [](ts::task<> &task, std::exception_ptr &exception) -> blocker {
+      try {
+        co_await task;
+      }
+      catch (...) {
+        exception = std::current_exception();
+      }
+    };
+
+    blocker::signal done;
+    body(task, exception).run(done);
+
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+}
@@ -0,0 +1,419 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "cancel.h"
+#include "job.h"
+
+namespace ts {
+  using timer_clock = std::chrono::steady_clock;
+
+  // resolution of timers
+  constexpr auto TIMER_TICK = std::chrono::milliseconds(1);
+
+  /**
+   * Hierarchical timer wheel; not thread-safe.
+   *
+   * Level `l` has 64 slots of `64^l` ticks each.
+   * Entries cascade to lower levels as time reaches their slot, and fire from level 0.
+   */
+  class timer_wheel {
+  public:
+    struct periodic {
+      std::function<void(size_t)> callback;
+      // `cancel` observes `stop`; jobs keep this alive while they hold it
+      job_config config;
+      uint64_t period;
+      cancel_source stop;
+
+      template<typename F>
+      periodic(F &&callback, const job_config &config, const uint64_t period)
+        : callback(std::forward<F>(callback)), config(config), period(period) {
+        this->config.cancel = stop.token();
+      }
+    };
+
+    struct entry {
+      uint64_t due;
+      // one-shot job, or null for periodic
+      job *target;
+      std::shared_ptr<periodic> repeat;
+    };
+
+  private:
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOT_COUNT = 1 << SLOT_BITS;
+    static constexpr size_t LEVEL_COUNT = 4;
+
+    std::array<std::array<std::vector<entry>, SLOT_COUNT>, LEVEL_COUNT> _slots;
+    // non-empty slots of each level
+    std::array<uint64_t, LEVEL_COUNT> _occupied{};
+    uint64_t _current = 0;
+    size_t _size = 0;
+
+    static uint64_t span(const size_t level) {
+      return uint64_t(1) << (SLOT_BITS * level);
+    }
+
+    static size_t slot_of(const uint64_t tick, const size_t level) {
+      return tick >> (SLOT_BITS * level) & (SLOT_COUNT - 1);
+    }
+
+    void place(entry &&e, std::vector<entry> &due) {
+      if (e.due <= _current) {
+        due.push_back(std::move(e));
+        return;
+      }
+
+      // too far ahead; parked in top level and re-placed when it cascades
+      const auto at = std::min(e.due, _current + span(LEVEL_COUNT) - 1);
+
+      size_t level = 0;
+      while (at - _current >= span(level + 1)) {
+        level++;
+      }
+
+      const auto slot = slot_of(at, level);
+      _slots[level][slot].push_back(std::move(e));
+      _occupied[level] |= uint64_t(1) << slot;
+    }
+
+    std::vector<entry> take(const size_t level, const size_t slot) {
+      _occupied[level] &= ~(uint64_t(1) << slot);
+      return std::exchange(_slots[level][slot], {});
+    }
+
+    // processes slots reached at `_current`
+    void tick(std::vector<entry> &due) {
+      for (size_t level = LEVEL_COUNT - 1; level > 0; --level) {
+        if (_current % span(level) == 0) {
+          for (auto &e : take(level, slot_of(_current, level))) {
+            place(std::move(e), due);
+          }
+        }
+      }
+
+      for (auto &e : take(0, slot_of(_current, 0))) {
+        due.push_back(std::move(e));
+      }
+    }
+
+  public:
+    [[nodiscard]] size_t size() const noexcept { return _size; }
+    [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+    [[nodiscard]] uint64_t current() const noexcept { return _current; }
+
+    /**
+     * Adds entry; appended to `due` right away if its tick has passed.
+     */
+    void add(entry e, std::vector<entry> &due) {
+      _size++;
+
+      const auto before = due.size();
+      place(std::move(e), due);
+      _size -= due.size() - before;
+    }
+
+    /**
+     * Moves time to `now`, appending entries that came due.
+     */
+    void advance(const uint64_t now, std::vector<entry> &due) {
+      const auto before = due.size();
+
+      while (_current < now) {
+        // lower levels are empty; jump straight to next slot boundary of lowest occupied level
+        size_t level = 0;
+        while (level < LEVEL_COUNT && _occupied[level] == 0) {
+          level++;
+        }
+        if (level == LEVEL_COUNT) {
+          _current = now;
+          break;
+        }
+
+        const auto next = (_current / span(level) + 1) * span(level);
+        if (next > now) {
+          _current = now;
+          break;
+        }
+
+        _current = next;
+        tick(due);
+      }
+
+      _size -= due.size() - before;
+    }
+
+    /**
+     * Lower bound of earliest due tick; none if empty.
+     */
+    [[nodiscard]]
+    std::optional<uint64_t> next() const {
+      std::optional<uint64_t> next;
+
+      for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+        if (_occupied[level] == 0) {
+          continue;
+        }
+
+        // first occupied slot at or after current one, wrapping around
+        const auto index = slot_of(_current, level);
+        const auto rotated = std::rotr(_occupied[level], static_cast<int>(index));
+        const auto distance = static_cast<uint64_t>(std::countr_zero(rotated));
+
+        const auto base = _current / span(level) * span(level);
+        auto at = base + distance * span(level);
+        if (distance == 0 && level > 0) {
+          // current slot of upper level holds next lap
+          at += span(level + 1);
+        }
+
+        next = std::min(next.value_or(at), at);
+      }
+
+      return next;
+    }
+
+    /**
+     * Removes every entry.
+     */
+    void clear(std::vector<entry> &out) {
+      for (size_t level = 0; level < LEVEL_COUNT; ++level) {
+        for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+          for (auto &e : take(level, slot)) {
+            out.push_back(std::move(e));
+          }
+        }
+      }
+      _size = 0;
+    }
+  };
+
+  /**
+   * Stops periodic timer of `scheduler::push_every`; copies refer to same timer.
+   */
+  class timer_handle {
+    std::shared_ptr<timer_wheel::periodic> _periodic;
+
+  public:
+    timer_handle() = default;
+
+    explicit timer_handle(std::shared_ptr<timer_wheel::periodic> periodic) noexcept : _periodic(std::move(periodic)) {
+    }
+
+    /**
+     * Stops timer; firing already pushed is discarded unless running.
+     * Entry leaves wheel when it next comes due.
+     */
+    void cancel() const noexcept {
+      if (_periodic) {
+        _periodic->stop.cancel();
+      }
+    }
+
+    [[nodiscard]]
+    bool cancelled() const noexcept {
+      return _periodic && _periodic->stop.cancelled();
+    }
+  };
+
+  /**
+   * Timers of scheduler, polled by workers.
+   * One parked worker at a time keeps deadline of earliest timer and sleeps only until it.
+   */
+  class timer_queue {
+    std::mutex _mutex;
+    timer_wheel _wheel;
+    const timer_clock::time_point _epoch;
+
+    // lower bound of earliest due tick; max if none
+    std::atomic_uint64_t _next;
+    // worker sleeping until earliest timer, if any
+    std::atomic<const void*> _keeper = nullptr;
+
+    [[nodiscard]]
+    uint64_t to_tick(const timer_clock::time_point time) const {
+      if (time <= _epoch) {
+        return 0;
+      }
+      // round up; timer never fires early
+      const auto ticks = (time - _epoch + TIMER_TICK - timer_clock::duration(1)) / TIMER_TICK;
+      return static_cast<uint64_t>(ticks);
+    }
+
+    [[nodiscard]]
+    timer_clock::time_point to_time(const uint64_t tick) const {
+      return _epoch + tick * TIMER_TICK;
+    }
+
+    void update_next() {
+      _next.store(_wheel.next().value_or(std::numeric_limits<uint64_t>::max()), std::memory_order::release);
+    }
+
+    template<typename Push>
+    void fire(std::vector<timer_wheel::entry> &due, const uint64_t now, Push &push) {
+      std::vector<timer_wheel::entry> again;
+
+      for (auto &e : due) {
+        if (e.target) {
+          push(e.target);
+          continue;
+        }
+
+        const auto &p = e.repeat;
+        if (p->stop.cancelled()) {
+          continue;
+        }
+
+        push(job::create([p](const size_t i) { p->callback(i); }, p->config, nullptr));
+
+        // skip missed periods rather than firing burst of them
+        e.due += p->period;
+        if (e.due <= now) {
+          e.due = now + p->period;
+        }
+        again.push_back(std::move(e));
+      }
+
+      due.clear();
+      if (!again.empty()) {
+        std::lock_guard lock(_mutex);
+        for (auto &e : again) {
+          _wheel.add(std::move(e), due);
+        }
+        update_next();
+      }
+    }
+
+  public:
+    timer_queue() : _epoch(timer_clock::now()), _next(std::numeric_limits<uint64_t>::max()) {
+    }
+
+    timer_queue(const timer_queue &) = delete;
+    timer_queue &operator=(const timer_queue &) = delete;
+
+    /**
+     * Adds timer entry.
+     *
+     * @return Whether it became earliest one; sleeping keeper must then be woken.
+     */
+    bool add(const timer_clock::time_point when, timer_wheel::entry e) {
+      e.due = to_tick(when);
+
+      std::vector<timer_wheel::entry> due;
+      {
+        std::lock_guard lock(_mutex);
+        if (_wheel.empty()) {
+          // nothing to fire; just catch up so that entry lands in low level
+          _wheel.advance(to_tick(timer_clock::now()), due);
+        }
+
+        // overdue entries are placed for next tick rather than fired by caller
+        e.due = std::max(e.due, _wheel.current() + 1);
+        _wheel.add(std::move(e), due);
+
+        const auto previous = _next.load(std::memory_order::relaxed);
+        update_next();
+        return _next.load(std::memory_order::relaxed) < previous;
+      }
+    }
+
+    [[nodiscard]]
+    bool pending() const noexcept {
+      return _next.load(std::memory_order::acquire) != std::numeric_limits<uint64_t>::max();
+    }
+
+    /**
+     * Fires due timers through `push(job*)`.
+     * Cheap when nothing is due; skipped if another thread is polling.
+     *
+     * @return Whether any job was pushed.
+     */
+    template<typename Push>
+    bool poll(Push &&push) {
+      if (!pending()) {
+        return false;
+      }
+
+      const auto now = to_tick(timer_clock::now());
+      if (_next.load(std::memory_order::acquire) > now) {
+        return false;
+      }
+
+      std::vector<timer_wheel::entry> due;
+      {
+        std::unique_lock lock(_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+          return false;
+        }
+
+        _wheel.advance(now, due);
+        update_next();
+      }
+
+      const auto fired = !due.empty();
+      fire(due, now, push);
+      return fired;
+    }
+
+    /**
+     * Claims keeping of earliest deadline for `owner`.
+     *
+     * @return Deadline to sleep until; none if another worker keeps it or no timer is pending.
+     */
+    [[nodiscard]]
+    std::optional<timer_clock::time_point> keep(const void *owner) {
+      const void *expected = nullptr;
+      if (!pending() || !_keeper.compare_exchange_strong(expected, owner, std::memory_order::acquire)) {
+        return std::nullopt;
+      }
+
+      const auto next = _next.load(std::memory_order::acquire);
+      if (next == std::numeric_limits<uint64_t>::max()) {
+        _keeper.store(nullptr, std::memory_order::release);
+        return std::nullopt;
+      }
+      return to_time(next);
+    }
+
+    void release_keeper() {
+      _keeper.store(nullptr, std::memory_order::release);
+    }
+
+    /**
+     * Owner passed to `keep` by current keeper; null if none.
+     */
+    [[nodiscard]]
+    const void *keeper() const noexcept {
+      return _keeper.load(std::memory_order::acquire);
+    }
+
+    /**
+     * Removes every timer; one-shot jobs are passed to `out(job*)`, periodic ones are dropped.
+     */
+    template<typename Out>
+    void clear(Out &&out) {
+      std::vector<timer_wheel::entry> entries;
+      {
+        std::lock_guard lock(_mutex);
+        _wheel.clear(entries);
+        update_next();
+      }
+
+      for (const auto &e : entries) {
+        if (e.target) {
+          out(e.target);
+        }
+      }
+    }
+  };
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <filesystem>
+#endif
+
+namespace ts {
+  enum class pin_policy {
+    // threads float; victims are picked uniformly
+    none,
+    // fill SMT siblings, then cores sharing L3, then node
+    compact,
+    // one worker per physical core first, alternating NUMA nodes
+    spread,
+  };
+
+  /**
+   * Steal distance between two CPUs; victims are tried in this order.
+   */
+  enum class cpu_distance : uint8_t {
+    smt,
+    l3,
+    node,
+    remote,
+  };
+
+  struct cpu_info {
+    size_t id;
+    size_t package;
+    // core id is only unique within its package
+    size_t core;
+    // lowest cpu sharing L3 with this one
+    size_t l3;
+    size_t node;
+
+    [[nodiscard]]
+    cpu_distance distance(const cpu_info &other) const noexcept {
+      if (package == other.package && core == other.core) {
+        return cpu_distance::smt;
+      }
+      if (l3 == other.l3) {
+        return cpu_distance::l3;
+      }
+      if (node == other.node) {
+        return cpu_distance::node;
+      }
+      return cpu_distance::remote;
+    }
+  };
+
+  /**
+   * Parses sysfs cpu list such as `0-3,8,10-11`.
+   */
+  inline std::vector<size_t> parse_cpu_list(const std::string &text) {
+    std::vector<size_t> cpus;
+
+    const char *s = text.c_str();
+    while (*s) {
+      char *end;
+      const auto first = std::strtoull(s, &end, 10);
+      if (end == s) {
+        break;
+      }
+
+      auto last = first;
+      if (*end == '-') {
+        s = end + 1;
+        last = std::strtoull(s, &end, 10);
+      }
+      for (auto cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+
+      s = *end == ',' ? end + 1 : end;
+    }
+
+    return cpus;
+  }
+
+  /**
+   * CPUs this process may run on, with their cache and NUMA placement.
+   * Empty where topology can't be detected; pinning is skipped then.
+   */
+  class topology {
+    std::vector<cpu_info> _cpus;
+
+#ifdef __linux__
+    static std::optional<size_t> read_number(const std::string &path) {
+      std::ifstream in(path);
+      size_t n;
+      if (in >> n) {
+        return n;
+      }
+      return std::nullopt;
+    }
+
+    static std::optional<size_t> read_first(const std::string &path) {
+      std::ifstream in(path);
+      std::string text;
+      if (std::getline(in, text)) {
+        if (const auto cpus = parse_cpu_list(text); !cpus.empty()) {
+          return cpus.front();
+        }
+      }
+      return std::nullopt;
+    }
+
+    static size_t read_node(const std::string &dir) {
+      std::error_code ec;
+      for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with("node")) {
+          return std::strtoull(name.c_str() + 4, nullptr, 10);
+        }
+      }
+      return 0;
+    }
+#endif
+
+  public:
+    topology() = default;
+
+    explicit topology(std::vector<cpu_info> cpus) : _cpus(std::move(cpus)) {
+    }
+
+    [[nodiscard]]
+    static topology detect() {
+      std::vector<cpu_info> cpus;
+
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return {};
+      }
+
+      for (size_t id = 0; id < CPU_SETSIZE; ++id) {
+        if (!CPU_ISSET(id, &set)) {
+          continue;
+        }
+
+        const auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+        const auto package = read_number(dir + "/topology/physical_package_id");
+        const auto core = read_number(dir + "/topology/core_id");
+        if (!package || !core) {
+          return {};
+        }
+
+        const auto l3 = read_first(dir + "/cache/index3/shared_cpu_list");
+        cpus.push_back({
+          id,
+          *package,
+          *core,
+          // without L3 info, assume package shares it
+          l3 ? *l3 : read_first(dir + "/topology/package_cpus_list").value_or(id),
+          read_node(dir),
+        });
+      }
+#endif
+
+      return topology(std::move(cpus));
+    }
+
+    [[nodiscard]]
+    const std::vector<cpu_info> &cpus() const noexcept {
+      return _cpus;
+    }
+
+    [[nodiscard]]
+    bool empty() const noexcept {
+      return _cpus.empty();
+    }
+
+    /**
+     * Picks cpu of each of `count` workers under `policy`.
+     * CPUs are reused round-robin when there are more workers than CPUs.
+     *
+     * @return Indices into `cpus()`; empty if nothing should be pinned.
+     */
+    [[nodiscard]]
+    std::vector<size_t> assign(const pin_policy policy, const size_t count) const {
+      if (policy == pin_policy::none || _cpus.empty()) {
+        return {};
+      }
+
+      // rank of cpu among its SMT siblings, and of its core within node
+      std::vector<size_t> smt(_cpus.size()), rank(_cpus.size());
+      for (size_t i = 0; i < _cpus.size(); ++i) {
+        std::optional<size_t> sibling;
+        for (size_t j = 0; j < i; ++j) {
+          if (_cpus[i].distance(_cpus[j]) == cpu_distance::smt) {
+            smt[i]++;
+            sibling = sibling.value_or(j);
+          }
+          else if (smt[j] == 0 && _cpus[j].node == _cpus[i].node) {
+            rank[i]++;
+          }
+        }
+
+        if (sibling) {
+          rank[i] = rank[*sibling];
+        }
+      }
+
+      std::vector<size_t> order(_cpus.size());
+      for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+      }
+
+      const auto key = [&](const size_t i) {
+        const auto &c = _cpus[i];
+        return policy == pin_policy::compact
+          ? std::tuple(c.node, c.l3, c.package, c.core, smt[i], c.id)
+          : std::tuple(smt[i], rank[i], c.node, c.l3, c.package, c.id);
+      };
+      std::ranges::stable_sort(order, [&key](const size_t a, const size_t b) { return key(a) < key(b); });
+
+      std::vector<size_t> assigned(count);
+      for (size_t i = 0; i < count; ++i) {
+        assigned[i] = order[i % order.size()];
+      }
+      return assigned;
+    }
+  };
+
+  /**
+   * Pins calling thread to `cpu`.
+   *
+   * @return Whether thread is pinned; always false outside Linux.
+   */
+  inline bool pin_current_thread(const size_t cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+      return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+  }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+
+namespace ts {
+#ifdef TS_TRACE
+  constexpr bool TRACE_ENABLED = true;
+#else
+  constexpr bool TRACE_ENABLED = false;
+#endif
+
+  // records kept per worker; older ones are overwritten
+  constexpr size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+  enum class trace_event : uint8_t {
+    job_begin,
+    job_end,
+    // arg: size of range split off
+    split,
+    // arg: victim worker id
+    steal,
+    // once per idle streak, so spinning doesn't flood the buffer
+    steal_fail,
+    park,
+    unpark,
+    // arg: priority level
+    global_pop,
+  };
+
+  struct trace_record {
+    uint64_t ticks;
+    uint32_t arg;
+    trace_event event;
+  };
+
+  /**
+   * Timestamp source of trace; TSC where available.
+   */
+  struct trace_clock {
+    [[nodiscard]]
+    static uint64_t now() noexcept {
+#if defined(__i386__) || defined(__x86_64__)
+      return __builtin_ia32_rdtsc();
+#else
+      return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+  };
+
+  /**
+   * Ring of fixed-size records with single writer.
+   * Reading is only safe while writer is quiescent (e.g. after scheduler is stopped).
+   */
+  class trace_ring {
+    std::unique_ptr<trace_record[]> _records;
+    size_t _mask;
+    std::atomic_size_t _head;
+
+  public:
+    explicit trace_ring(const size_t size = TRACE_BUFFER_SIZE)
+      : _records(std::make_unique<trace_record[]>(size)), _mask(size - 1), _head(0) {
+      assert(std::popcount(size) == 1);
+    }
+
+    void record(const trace_event event, const uint32_t arg = 0) noexcept {
+      const auto head = _head.load(std::memory_order::relaxed);
+      _records[head & _mask] = { trace_clock::now(), arg, event };
+      _head.store(head + 1, std::memory_order::release);
+    }
+
+    /**
+     * Calls `f(record)` for each retained record, oldest first.
+     */
+    template<typename F>
+    void for_each(F &&f) const {
+      const auto head = _head.load(std::memory_order::acquire);
+      const auto size = _mask + 1;
+      for (size_t i = head > size ? head - size : 0; i < head; ++i) {
+        f(_records[i & _mask]);
+      }
+    }
+  };
+
+  class trace_stub {
+  public:
+    void record(trace_event, uint32_t = 0) noexcept {
+    }
+
+    template<typename F>
+    void for_each(F &&) const {
+    }
+  };
+
+  // compiles to nothing unless `TS_TRACE` is defined
+  using trace_buffer = std::conditional_t<TRACE_ENABLED, trace_ring, trace_stub>;
+
+  /**
+   * Converts trace ticks to microseconds since construction.
+   * Tick rate is measured against steady clock over lifetime of this object.
+   */
+  class trace_timebase {
+    uint64_t _ticks;
+    std::chrono::steady_clock::time_point _time;
+
+  public:
+    trace_timebase() : _ticks(trace_clock::now()), _time(std::chrono::steady_clock::now()) {
+    }
+
+    [[nodiscard]]
+    double ticks_per_us() const {
+      const auto ticks = trace_clock::now() - _ticks;
+      const auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _time).count();
+      return us > 0 && ticks > 0 ? ticks / us : 1.0;
+    }
+
+    [[nodiscard]]
+    double to_us(const uint64_t ticks, const double ticks_per_us) const {
+      return ticks > _ticks ? (ticks - _ticks) / ticks_per_us : 0.0;
+    }
+  };
+
+  /**
+   * Writes one worker's records as Chrome trace events (without surrounding array).
+   * Jobs and parks are duration events; the rest are thread-scoped instants.
+   */
+  template<typename Buffer>
+  void write_trace_events(
+    std::ostream &out,
+    const Buffer &buffer,
+    const size_t tid,
+    const trace_timebase &timebase,
+    const double ticks_per_us,
+    bool &first
+  ) {
+    const auto separator = [&out, &first] {
+      out << (first ? "\n" : ",\n");
+      first = false;
+    };
+
+    separator();
+    out << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << tid
+      << R"(,"args":{"name":"worker )" << tid << R"("}})";
+
+    buffer.for_each([&](const trace_record &record) {
+      const char *name;
+      const char *phase = "i";
+      switch (record.event) {
+        case trace_event::job_begin: name = "job"; phase = "B"; break;
+        case trace_event::job_end: name = "job"; phase = "E"; break;
+        case trace_event::park: name = "park"; phase = "B"; break;
+        case trace_event::unpark: name = "park"; phase = "E"; break;
+        case trace_event::split: name = "split"; break;
+        case trace_event::steal: name = "steal"; break;
+        case trace_event::steal_fail: name = "steal_fail"; break;
+        case trace_event::global_pop: name = "global_pop"; break;
+        default: return;
+      }
+
+      separator();
+      out << R"({"name":")" << name << R"(","ph":")" << phase << R"(","pid":0,"tid":)" << tid
+        << R"(,"ts":)" << timebase.to_us(record.ticks, ticks_per_us);
+      if (*phase == 'i') {
+        out << R"(,"s":"t","args":{"arg":)" << record.arg << "}";
+      }
+      out << "}";
+    });
+  }
+}
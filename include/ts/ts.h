@@ -1,6 +1,23 @@
 #pragma once
 
+#include "cancel.h"
+#include "injector.h"
+#include "io.h"
 #include "job.h"
+#include "mailbox.h"
+#include "net.h"
+#include "parallel.h"
+#include "park.h"
+#include "poller.h"
 #include "queue.h"
+#include "reclaim.h"
 #include "scheduler.h"
+#include "slab.h"
+#include "stats.h"
+#include "sync.h"
+#include "task.h"
+#include "timer.h"
+#include "topology.h"
+#include "trace.h"
+#include "uring.h"
 #include "worker.h"
@@ -0,0 +1,475 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TS_URING
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "park.h"
+
+namespace ts {
+  /**
+   * Completion of single ring operation.
+   * Ring stores its address as user data; reaping worker sets `result` and resumes `handle`.
+   */
+  struct io_completion {
+    std::coroutine_handle<> handle;
+    int32_t result = 0;
+  };
+
+#ifdef TS_URING
+  /**
+   * io_uring instance of single worker, driven by raw system calls.
+   *
+   * Only owning worker prepares, submits and reaps.
+   * Prepared entries are batched until `submit`, which happens once worker runs out of local work.
+   * While waiting for completions, ring also polls eventfd so that `eventcount` can wake it.
+   */
+  class io_ring final : public waker {
+    // user data of wake poll and of cancel request; operations carry address of their completion
+    static constexpr uint64_t WAKE_TAG = 0;
+    static constexpr uint64_t CANCEL_TAG = 1;
+
+    int _fd = -1;
+    int _wake = -1;
+
+    void *_sq_map = nullptr;
+    size_t _sq_map_size = 0;
+    void *_cq_map = nullptr;
+    size_t _cq_map_size = 0;
+    io_uring_sqe *_sqes = nullptr;
+    size_t _sqes_size = 0;
+
+    std::atomic_uint32_t *_sq_head = nullptr;
+    std::atomic_uint32_t *_sq_tail = nullptr;
+    uint32_t _sq_mask = 0;
+    uint32_t *_sq_array = nullptr;
+    uint32_t _sq_entries = 0;
+
+    std::atomic_uint32_t *_cq_head = nullptr;
+    std::atomic_uint32_t *_cq_tail = nullptr;
+    uint32_t _cq_mask = 0;
+    io_uring_cqe *_cqes = nullptr;
+    uint32_t _cq_entries = 0;
+
+    // prepared but not yet published to kernel
+    uint32_t _tail = 0;
+    uint32_t _unsubmitted = 0;
+    size_t _inflight = 0;
+    bool _wake_armed = false;
+    size_t _fixed = 0;
+
+    template<typename T>
+    static T *at(void *base, const uint32_t offset) {
+      return reinterpret_cast<T*>(static_cast<std::byte*>(base) + offset);
+    }
+
+    int enter(const uint32_t submit, const uint32_t wait, uint32_t flags, const void *arg, const size_t size) {
+      const auto result = static_cast<int>(syscall(__NR_io_uring_enter, _fd, submit, wait, flags, arg, size));
+      if (result > 0) {
+        _unsubmitted -= std::min<uint32_t>(_unsubmitted, result);
+      }
+      return result;
+    }
+
+    void publish() {
+      _sq_tail->store(_tail, std::memory_order::release);
+    }
+
+    void close() {
+      if (_sqes) {
+        munmap(_sqes, _sqes_size);
+      }
+      if (_cq_map && _cq_map != _sq_map) {
+        munmap(_cq_map, _cq_map_size);
+      }
+      if (_sq_map) {
+        munmap(_sq_map, _sq_map_size);
+      }
+      if (_fd >= 0) {
+        ::close(_fd);
+      }
+      if (_wake >= 0) {
+        ::close(_wake);
+      }
+
+      _fd = _wake = -1;
+      _sq_map = _cq_map = _sqes = nullptr;
+    }
+
+  public:
+    /**
+     * Sets up ring of `entries` submission entries.
+     * Ring is invalid if kernel lacks io_uring or extended wait arguments (Linux 5.11).
+     */
+    explicit io_ring(const uint32_t entries) {
+      io_uring_params params{};
+      _fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+      if (_fd < 0 || !(params.features & IORING_FEAT_EXT_ARG)) {
+        close();
+        return;
+      }
+
+      _sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+      _cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      const auto single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single) {
+        _sq_map_size = _cq_map_size = std::max(_sq_map_size, _cq_map_size);
+      }
+
+      _sq_map = mmap(nullptr, _sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+      if (_sq_map == MAP_FAILED) {
+        _sq_map = nullptr;
+        close();
+        return;
+      }
+
+      _cq_map = single
+        ? _sq_map
+        : mmap(nullptr, _cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+      if (_cq_map == MAP_FAILED) {
+        _cq_map = nullptr;
+        close();
+        return;
+      }
+
+      _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+      const auto sqes = mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+      if (sqes == MAP_FAILED) {
+        close();
+        return;
+      }
+      _sqes = static_cast<io_uring_sqe*>(sqes);
+
+      _sq_head = at<std::atomic_uint32_t>(_sq_map, params.sq_off.head);
+      _sq_tail = at<std::atomic_uint32_t>(_sq_map, params.sq_off.tail);
+      _sq_mask = *at<uint32_t>(_sq_map, params.sq_off.ring_mask);
+      _sq_array = at<uint32_t>(_sq_map, params.sq_off.array);
+      _sq_entries = params.sq_entries;
+
+      _cq_head = at<std::atomic_uint32_t>(_cq_map, params.cq_off.head);
+      _cq_tail = at<std::atomic_uint32_t>(_cq_map, params.cq_off.tail);
+      _cq_mask = *at<uint32_t>(_cq_map, params.cq_off.ring_mask);
+      _cqes = at<io_uring_cqe>(_cq_map, params.cq_off.cqes);
+      _cq_entries = params.cq_entries;
+
+      _tail = _sq_tail->load(std::memory_order::relaxed);
+
+      _wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (_wake < 0) {
+        close();
+      }
+    }
+
+    io_ring(const io_ring &) = delete;
+    io_ring &operator=(const io_ring &) = delete;
+
+    ~io_ring() {
+      close();
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return _fd >= 0; }
+    [[nodiscard]] size_t inflight() const noexcept { return _inflight; }
+    [[nodiscard]] uint32_t unsubmitted() const noexcept { return _unsubmitted; }
+    // number of registered buffers
+    [[nodiscard]] size_t fixed() const noexcept { return _fixed; }
+
+    /**
+     * Next free submission entry, zeroed, with `completion` as user data.
+     * Null if ring is full; caller should `submit` and try again.
+     */
+    [[nodiscard]]
+    io_uring_sqe *prepare(io_completion *completion) {
+      if (_tail - _sq_head->load(std::memory_order::acquire) >= _sq_entries || _inflight + 1 >= _cq_entries) {
+        return nullptr;
+      }
+
+      const auto index = _tail & _sq_mask;
+      const auto sqe = &_sqes[index];
+      *sqe = {};
+      sqe->user_data = reinterpret_cast<uint64_t>(completion);
+
+      _sq_array[index] = index;
+      _tail++;
+      _unsubmitted++;
+      _inflight++;
+      return sqe;
+    }
+
+    /**
+     * Hands every prepared entry to kernel in single call.
+     */
+    void submit() {
+      if (_unsubmitted == 0) {
+        return;
+      }
+
+      publish();
+      enter(_unsubmitted, 0, 0, nullptr, 0);
+    }
+
+    /**
+     * Asks kernel to cancel every operation in flight and submits the request;
+     * cancelled ones complete with `-ECANCELED`, others as they finish.
+     * Needs Linux 5.19; on older kernels operations just run to completion.
+     */
+    void cancel() {
+#ifdef IORING_ASYNC_CANCEL_ANY
+      if (_tail - _sq_head->load(std::memory_order::acquire) >= _sq_entries) {
+        submit();
+        if (_tail - _sq_head->load(std::memory_order::acquire) >= _sq_entries) {
+          return;
+        }
+      }
+
+      const auto index = _tail & _sq_mask;
+      const auto sqe = &_sqes[index];
+      *sqe = {};
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+      sqe->user_data = CANCEL_TAG;
+
+      _sq_array[index] = index;
+      _tail++;
+      _unsubmitted++;
+      submit();
+#endif
+    }
+
+    /**
+     * Submits prepared entries and sleeps until any completion, `wake` or `deadline`.
+     */
+    void wait(const std::optional<std::chrono::steady_clock::time_point> deadline) {
+      if (!_wake_armed) {
+        const auto index = _tail & _sq_mask;
+        const auto sqe = &_sqes[index];
+        if (_tail - _sq_head->load(std::memory_order::acquire) < _sq_entries) {
+          *sqe = {};
+          sqe->opcode = IORING_OP_POLL_ADD;
+          sqe->fd = _wake;
+          sqe->poll32_events = POLLIN;
+          sqe->user_data = WAKE_TAG;
+
+          _sq_array[index] = index;
+          _tail++;
+          _unsubmitted++;
+          _wake_armed = true;
+        }
+      }
+      publish();
+
+      __kernel_timespec ts{};
+      io_uring_getevents_arg arg{};
+      if (deadline) {
+        const auto left = std::max(*deadline - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration(0));
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        ts.tv_sec = ns / 1000000000;
+        ts.tv_nsec = ns % 1000000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+      }
+
+      enter(_unsubmitted, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+
+    /**
+     * Calls `complete(io_completion*)` for each finished operation.
+     *
+     * @return Number of finished operations.
+     */
+    template<typename Complete>
+    size_t reap(Complete &&complete) {
+      size_t count = 0;
+
+      auto head = _cq_head->load(std::memory_order::relaxed);
+      const auto tail = _cq_tail->load(std::memory_order::acquire);
+      for (; head != tail; ++head) {
+        const auto &cqe = _cqes[head & _cq_mask];
+
+        if (cqe.user_data == WAKE_TAG) {
+          uint64_t value;
+          [[maybe_unused]] const auto n = ::read(_wake, &value, sizeof(value));
+          _wake_armed = false;
+          continue;
+        }
+        if (cqe.user_data == CANCEL_TAG) {
+          continue;
+        }
+
+        const auto completion = reinterpret_cast<io_completion*>(cqe.user_data);
+        completion->result = cqe.res;
+        _inflight--;
+        count++;
+        complete(completion);
+      }
+
+      _cq_head->store(head, std::memory_order::release);
+      return count;
+    }
+
+    /**
+     * Registers `buffers` for fixed reads and writes; replaces previous ones.
+     * Must not be called while fixed operations are in flight.
+     */
+    bool register_buffers(const std::span<const std::span<std::byte>> buffers) {
+      syscall(__NR_io_uring_register, _fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+      _fixed = 0;
+      if (buffers.empty()) {
+        return true;
+      }
+
+      std::vector<iovec> iovecs;
+      iovecs.reserve(buffers.size());
+      for (const auto &buffer : buffers) {
+        iovecs.push_back({buffer.data(), buffer.size()});
+      }
+
+      if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size()) != 0) {
+        return false;
+      }
+
+      _fixed = buffers.size();
+      return true;
+    }
+
+    void wake() noexcept override {
+      const uint64_t one = 1;
+      [[maybe_unused]] const auto n = ::write(_wake, &one, sizeof(one));
+    }
+  };
+#else
+  // io_uring is unavailable; every operation completes synchronously
+  class io_ring final : public waker {
+  public:
+    explicit io_ring(uint32_t) {
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return false; }
+    [[nodiscard]] size_t inflight() const noexcept { return 0; }
+    [[nodiscard]] uint32_t unsubmitted() const noexcept { return 0; }
+    [[nodiscard]] size_t fixed() const noexcept { return 0; }
+
+    void submit() {
+    }
+
+    void cancel() {
+    }
+
+    void wait(std::optional<std::chrono::steady_clock::time_point>) {
+    }
+
+    template<typename Complete>
+    size_t reap(Complete &&) {
+      return 0;
+    }
+
+    bool register_buffers(std::span<const std::span<std::byte>>) {
+      return false;
+    }
+
+    void wake() noexcept override {
+    }
+  };
+#endif
+
+  /**
+   * Rings of scheduler's workers, one per worker, each set up on its worker's first I/O;
+   * programs doing no I/O pay for no ring.
+   * Workers whose ring couldn't be set up run I/O synchronously.
+   */
+  class io_reactor {
+    const uint32_t _entries;
+
+    // guards rings and buffers against registering while a worker sets up its ring
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<io_ring>> _rings;
+    std::vector<std::span<std::byte>> _buffers;
+
+  public:
+    /**
+     * @param entries Submission entries of each ring; 0 disables io_uring.
+     */
+    io_reactor(const size_t workers, const uint32_t entries) : _entries(entries), _rings(workers) {
+    }
+
+    io_reactor(const io_reactor &) = delete;
+    io_reactor &operator=(const io_reactor &) = delete;
+
+    [[nodiscard]] bool enabled() const noexcept { return _entries > 0; }
+
+    /**
+     * Sets up ring of `worker`, with buffers registered so far; called once, by that worker.
+     *
+     * @return Ring; null if io_uring is disabled or setup failed, e.g. under `RLIMIT_MEMLOCK`.
+     */
+    io_ring *open(const size_t worker) {
+      if (!enabled() || worker >= _rings.size()) {
+        return nullptr;
+      }
+
+      auto ring = std::make_unique<io_ring>(_entries);
+      if (!ring->valid()) {
+        return nullptr;
+      }
+
+      std::lock_guard lock(_mutex);
+      if (!_buffers.empty()) {
+        ring->register_buffers(_buffers);
+      }
+      _rings[worker] = std::move(ring);
+      return _rings[worker].get();
+    }
+
+    /**
+     * Ring of `worker`; null until it has done I/O.
+     */
+    [[nodiscard]]
+    io_ring *ring(const size_t worker) const {
+      std::lock_guard lock(_mutex);
+      return worker < _rings.size() ? _rings[worker].get() : nullptr;
+    }
+
+    /**
+     * Registers `buffers` with every ring; `buffer(i)` is then usable by fixed operations.
+     * Call before scheduler starts or while no fixed operation is in flight.
+     *
+     * @return Whether every ring accepted them; fixed operations fall back to plain ones otherwise.
+     */
+    bool register_buffers(std::vector<std::span<std::byte>> buffers) {
+      std::lock_guard lock(_mutex);
+      _buffers = std::move(buffers);
+
+      auto ok = true;
+      for (const auto &ring : _rings) {
+        if (ring) {
+          ok = ring->register_buffers(_buffers) && ok;
+        }
+      }
+      return ok;
+    }
+
+    [[nodiscard]]
+    std::span<std::byte> buffer(const size_t index) const {
+      std::lock_guard lock(_mutex);
+      return _buffers.at(index);
+    }
+  };
+}
@@ -1,10 +1,22 @@
 #pragma once
 
 #include <chrono>
+#include <mutex>
+#include <span>
+#include <stdexcept>
 #include <thread>
 
+#include "injector.h"
 #include "job.h"
+#include "mailbox.h"
+#include "park.h"
+#include "poller.h"
 #include "queue.h"
+#include "stats.h"
+#include "timer.h"
+#include "topology.h"
+#include "trace.h"
+#include "uring.h"
 
 namespace ts {
   inline uint32_t rnd32() {
@@ -35,14 +47,47 @@ namespace ts {
   }
 
 
+  // every this many global pops, lower levels are looked at first
+  constexpr size_t PRIORITY_GUARD_INTERVAL = 16;
+
+  // jobs taken from producer feed at once; all but first go to local deque
+  constexpr size_t FEED_BATCH_SIZE = 32;
+
+  // busy worker checks timers, I/O completions and sockets after running this many jobs
+  constexpr size_t POLL_INTERVAL = 64;
+
   class worker {
     std::atomic_flag _active = ATOMIC_FLAG_INIT;
 
     const std::vector<std::unique_ptr<worker>> &_workers;
     size_t _id;
 
-    vyukov<job*> &_global;
+    injector &_global;
+    size_t _pops = 0;
+    // next producer feed to look at
+    size_t _feed = 0;
     chaselev<job*> _local;
+    // jobs addressed to this worker; never stolen
+    mailbox _mailbox;
+    eventcount &_idle;
+    parker _parker;
+    timer_queue *_timers;
+    io_reactor *_io;
+    // set up on first I/O; null until then, and for good if that failed
+    io_ring *_ring = nullptr;
+    bool _ring_opened = false;
+    io_poller *_poller;
+    size_t _runs = 0;
+    // spare out of use; finishes own jobs, then rests until resumed
+    std::atomic_bool _retired = false;
+    std::once_flag _launch;
+
+    worker_counters _counters;
+    [[no_unique_address]] trace_buffer _trace;
+
+    // steal victims grouped by distance, nearest first
+    std::vector<std::vector<size_t>> _victims;
+    std::optional<size_t> _cpu;
 
     std::optional<std::jthread> _thread;
 
@@ -53,87 +98,306 @@ namespace ts {
 
     // note: job must be dynamically allocated
     job *chunk(job *job) {
-      while (job->size() > job->batch()) {
+      if (job->lazy()) {
+        while (job->size() > job->batch() && !job->cancelled()) {
+          // nothing left for thieves; offer them half of remainder
+          if (_local.empty() && job->stealable()) {
+            _counters.split();
+            _trace.record(trace_event::split, job->size() - job->size() / 2);
+            push(job->split(job->size() / 2));
+            // kept half may be a batch or less already
+            continue;
+          }
+
+          job->advance(job->batch());
+        }
+
+        return job;
+      }
+
+      while (job->size() > job->batch() && !job->cancelled()) {
         const auto right = job->split(job->size() / 2);
+        _counters.split();
+        _trace.record(trace_event::split, right->size());
         push(right);
       }
 
       return job;
     }
 
+    void place(job *job) {
+      if (!job->stealable()) {
+        _mailbox.push(job);
+        return;
+      }
+
+      if (!_local.try_push(job) && !_global.push(job)) {
+        _local.push(job);
+      }
+    }
+
+    // starvation guard; returns level to start looking from
+    size_t next_level() {
+      if (++_pops % PRIORITY_GUARD_INTERVAL != 0) {
+        return 0;
+      }
+      return 1 + _pops / PRIORITY_GUARD_INTERVAL % (PRIORITY_COUNT - 1);
+    }
+
+    job *pop_global(const size_t first) {
+      for (size_t i = 0; i < PRIORITY_COUNT; ++i) {
+        const auto level = static_cast<job_priority>((first + i) % PRIORITY_COUNT);
+        if (const auto opt = _global.pop(level)) {
+          _counters.global();
+          _trace.record(trace_event::global_pop, static_cast<uint32_t>(level));
+          return opt.value();
+        }
+      }
+
+      return nullptr;
+    }
+
     job *take() {
+      const auto first = next_level();
+      // count read stays in cache while no high-priority job comes; one being pushed is found at the end
+      if (first == 0 && !_global.empty(job_priority::high)) {
+        if (const auto opt = _global.pop(job_priority::high)) {
+          _counters.global();
+          _trace.record(trace_event::global_pop);
+          return opt.value();
+        }
+      }
+
+      if (const auto job = _mailbox.pop()) {
+        _counters.local();
+        return job;
+      }
+
       if (const auto opt = _local.take()) {
+        _counters.local();
         return opt.value();
       }
 
-      if (const auto size = _workers.size(); size > 1) {
-        auto ofs = rnd32() % (size - 1) + 1;
-        ofs = (_id + ofs) % size;
+      // walk every other worker, nearer groups first, starting from random one in each
+      for (const auto &group : _victims) {
+        const auto size = group.size();
+        const auto start = size > 1 ? rnd32() % size : 0;
+        for (size_t i = 0; i < size; ++i) {
+          const auto victim = group[(start + i) % size];
+          if (_workers[victim]->_retired.load(std::memory_order::relaxed)) {
+            continue;
+          }
 
-        if (const auto opt = _workers[ofs]->_local.steal()) {
-          return opt.value();
+          if (const auto opt = _workers[victim]->_local.steal_half(_local)) {
+            _counters.steal();
+            _trace.record(trace_event::steal, victim);
+            return opt.value();
+          }
         }
       }
 
-      if (const auto opt = _global.pop()) {
-        return opt.value();
+      // on guard turns global queue goes before feeds, so neither starves the other
+      if (first != 0) {
+        if (const auto job = pop_global(first)) {
+          return job;
+        }
       }
 
-      return nullptr;
+      size_t placed = 0;
+      const auto fed = _global.drain(_feed, FEED_BATCH_SIZE, [this, &placed](ts::job *job) {
+        place(job);
+        placed++;
+      });
+      if (fed) {
+        _counters.global();
+        _trace.record(trace_event::global_pop);
+        _idle.notify(placed);
+        return fed;
+      }
+
+      return first == 0 ? pop_global(first) : nullptr;
+    }
+
+    // due timers go to local deque
+    bool poll_timers() {
+      return _timers && _timers->poll([this](ts::job *job) { push(job); });
+    }
+
+    // submits batched I/O; completed operations resume from local deque
+    bool poll_io() {
+      if (!_ring) {
+        return false;
+      }
+
+      _ring->submit();
+      return _ring->reap([this](const io_completion *completion) {
+        const auto h = completion->handle;
+        push(job::create([h](size_t) { h.resume(); }, {}, nullptr));
+      }) > 0;
+    }
+
+    // ready socket waiters go to local deque
+    bool poll_net() {
+      return _poller && _poller->poll([this](ts::job *job) { push(job); });
+    }
+
+    void park(const uint64_t key) {
+      _counters.park();
+      _trace.record(trace_event::park);
+
+      // one parked worker sleeps until earliest timer; others until notified
+      const auto deadline = _timers ? _timers->keep(this) : std::nullopt;
+
+      if (_ring && _ring->inflight() > 0) {
+        // sleep in ring so that completions wake us as well
+        if (_idle.arm(key, *_ring, this)) {
+          _ring->wait(deadline);
+        }
+        _idle.disarm(*_ring);
+      }
+      else if (_poller && _poller->keep()) {
+        // one parked worker blocks in epoll for sockets
+        if (_idle.arm(key, *_poller, this)) {
+          _poller->wait(deadline, [this](ts::job *job) { place(job); });
+        }
+        _idle.disarm(*_poller);
+        _poller->release_keeper();
+
+        if (_poller->registered()) {
+          _idle.notify_one();
+        }
+      }
+      else {
+        if (_idle.arm(key, _parker, this)) {
+          _parker.wait(deadline);
+        }
+        _idle.disarm(_parker);
+      }
+
+      if (deadline) {
+        _timers->release_keeper();
+
+        // hand deadline over in case this worker gets busy
+        if (_timers->pending()) {
+          _idle.notify_one();
+        }
+      }
+
+      _trace.record(trace_event::unpark);
     }
 
     void loop() {
       instance() = this;
 
+      if (_cpu && pin_current_thread(*_cpu)) {
+        // deque was allocated by constructing thread; move it next to us
+        _local.rehome();
+      }
+
       size_t miss = 0;
       while (_active.test()) {
+        // operations in flight on own ring must be reaped before resting
+        if (_retired.load(std::memory_order::acquire) && _local.empty() && _mailbox.empty()
+          && !(_ring && _ring->inflight() > 0)) {
+          _retired.wait(true, std::memory_order::acquire);
+          miss = 0;
+          continue;
+        }
+
         job *job = take();
         if (!job) {
+          if (miss == 0) {
+            _trace.record(trace_event::steal_fail);
+          }
+
+          if (poll_timers() | poll_io() | poll_net()) {
+            continue;
+          }
+
           if (miss < 2000) {
             miss++;
+            _counters.spin();
             cpu_relax();
             continue;
           }
 
           if (miss < 10000) {
             miss++;
+            _counters.yield();
             std::this_thread::yield();
             continue;
           }
 
-          if (auto opt = _global.blocking_pop()) {
-            job = opt.value();
+          // look once more after announcing; any push from now on wakes us
+          const auto key = _idle.prepare();
+          if (!_active.test()) {
+            _idle.cancel();
+            break;
           }
-          else {
+
+          job = take();
+          if (!job) {
+            park(key);
             continue;
           }
+
+          _idle.cancel();
         }
 
         miss = 0;
+        run(job);
 
-        std::optional<ts::job*> next;
-        for (;;) {
-          next = chunk(job)->call();
-          job->yield();
+        if (++_runs % POLL_INTERVAL == 0) {
+          poll_timers();
+          poll_io();
+          poll_net();
+        }
+      }
 
-          if (!next) {
-            break;
-          }
+      // kernel must not touch awaiting frames once we are gone;
+      // cancelled operations resume their coroutines here, as deque is not run anymore
+      while (_ring && _ring->inflight() > 0) {
+        _ring->cancel();
 
-          job = next.value();
+        size_t reaped = 0;
+        while (reaped == 0) {
+          _ring->wait(std::nullopt);
+          reaped = _ring->reap([](const io_completion *completion) { completion->handle.resume(); });
         }
       }
     }
 
+    void run(job *job) {
+      for (;;) {
+        _counters.run();
+        _trace.record(trace_event::job_begin);
+        const auto next = chunk(job)->call([this](ts::job *ready) { push(ready); });
+        _trace.record(trace_event::job_end);
+        if (!next) {
+          break;
+        }
+
+        job = next.value();
+      }
+    }
+
   public:
     worker(
       const std::vector<std::unique_ptr<worker>> &workers,
-      vyukov<job*> &global,
-      const size_t size)
+      injector &global,
+      eventcount &idle,
+      const size_t size,
+      timer_queue *timers = nullptr,
+      io_reactor *io = nullptr,
+      io_poller *poller = nullptr)
       : _workers(workers),
         _id(-1),
         _global(global),
-        _local(size) {
+        _local(size),
+        _idle(idle),
+        _timers(timers),
+        _io(io),
+        _poller(poller) {
     }
 
     [[nodiscard]]
@@ -143,16 +407,166 @@ namespace ts {
 
     [[nodiscard]] size_t id() const { return _id; }
 
+    /**
+     * Whether jobs wait in this worker's deque or mailbox; owner only.
+     */
+    [[nodiscard]]
+    bool busy() const noexcept {
+      return !_local.empty() || !_mailbox.empty();
+    }
+
+    /**
+     * Ring that I/O awaited on this worker goes through, set up on first call; owner only.
+     * Null if I/O runs synchronously.
+     */
+    [[nodiscard]]
+    io_ring *ring() {
+      if (!_ring_opened && _io) {
+        _ring_opened = true;
+        _ring = _io->open(_id);
+        if (!_ring && _io->enabled()) {
+          _counters.ring_fail();
+        }
+      }
+      return _ring;
+    }
+
+    /**
+     * Sets cpu to pin thread to and steal victims grouped by distance, nearest first.
+     * Must be called before `start`; without it, thread floats and all other workers form single group.
+     */
+    void bind(const std::optional<size_t> cpu, std::vector<std::vector<size_t>> victims) {
+      _cpu = cpu;
+      _victims = std::move(victims);
+    }
+
+    /**
+     * Snapshot of this worker's counters; callable from any thread.
+     */
+    [[nodiscard]]
+    worker_stats stats() const noexcept {
+      return _counters.snapshot();
+    }
+
+    /**
+     * Trace records of this worker; empty unless built with `TS_TRACE`.
+     */
+    [[nodiscard]]
+    const trace_buffer &trace() const noexcept {
+      return _trace;
+    }
+
+    /**
+     * Runs other jobs on this worker until `pred` holds.
+     * Must be called from this worker's thread.
+     */
+    template<typename Pred>
+    void run_until(Pred &&pred) {
+      assert(current() == this);
+
+      size_t miss = 0;
+      while (!pred()) {
+        if (const auto job = take()) {
+          miss = 0;
+          run(job);
+          continue;
+        }
+
+        if (poll_timers() | poll_io() | poll_net()) {
+          continue;
+        }
+
+        if (miss < 2000) {
+          miss++;
+          _counters.spin();
+          cpu_relax();
+        }
+        else {
+          _counters.yield();
+          std::this_thread::yield();
+        }
+      }
+    }
+
     void push(job *job) {
-      if (_local.try_push(job)) {
-        return;
+      // job may be gone once placed
+      const auto stealable = job->stealable();
+      place(job);
+      if (stealable) {
+        _idle.notify_one();
       }
+    }
 
-      if (_global.push(job)) {
-        return;
+    void push_batch(const std::span<job* const> jobs) {
+      for (const auto job : jobs) {
+        place(job);
       }
 
-      _local.push(job);
+      _idle.notify(jobs.size());
+    }
+
+    /**
+     * Takes `job` off local deque if it is still at bottom, so that nobody else runs it; owner only.
+     */
+    [[nodiscard]]
+    bool take_back(const job *job) {
+      const auto opt = _local.take();
+      if (!opt) {
+        return false;
+      }
+      if (opt.value() == job) {
+        return true;
+      }
+
+      _local.push(opt.value());
+      return false;
+    }
+
+    /**
+     * Hands job to this worker from any thread; it runs here even if stealable,
+     * though ranges it splits into may be stolen unless it isn't.
+     * Wakes this worker specifically if parked.
+     */
+    void post(job *job) {
+      _mailbox.push(job);
+      if (current() != this) {
+        _idle.notify_owner(this);
+      }
+    }
+
+    /**
+     * Puts spare worker back to work, starting its thread on first use.
+     *
+     * @return Whether it was retired.
+     */
+    bool resume() {
+      auto expected = true;
+      if (!_retired.compare_exchange_strong(expected, false, std::memory_order::acq_rel)) {
+        return false;
+      }
+
+      _retired.notify_one();
+      std::call_once(_launch, [this] { start(); });
+      return true;
+    }
+
+    /**
+     * Takes spare worker out of use; it finishes jobs of its own first.
+     * Stolen from by nobody while retired.
+     */
+    void retire() {
+      _retired.store(true, std::memory_order::release);
+      _idle.notify_owner(this);
+    }
+
+    /**
+     * Takes jobs left in mailbox; only after `stop`.
+     */
+    template<typename Out>
+    void drain_mailbox(Out &&out) {
+      while (const auto job = _mailbox.pop()) {
+        out(job);
+      }
     }
 
     bool start() {
@@ -170,18 +584,29 @@ namespace ts {
         throw std::invalid_argument("Worker must be initialized with worker list that contains self");
       }
 
+      if (_victims.empty()) {
+        auto &group = _victims.emplace_back();
+        for (size_t i = 0; i < _workers.size(); ++i) {
+          if (i != _id) {
+            group.push_back(i);
+          }
+        }
+      }
+
       _thread.emplace([this] { loop(); });
 
       return true;
     }
 
-    // note: global queue must be killed before stopping worker
     void stop() {
       if (!_active.test()) {
         return;
       }
 
       _active.clear();
+      _retired.store(false, std::memory_order::release);
+      _retired.notify_one();
+      _idle.notify_all();
       if (_thread && _thread->joinable()) {
         _thread->join();
       }
@@ -193,4 +618,19 @@ namespace ts {
       stop();
     }
   };
+
+  inline void handle::wait() const {
+    if (done()) {
+      return;
+    }
+
+    if (const auto current = worker::current()) {
+      current->run_until([this] { return done(); });
+      return;
+    }
+
+    while (!_job->_done.test(acquire)) {
+      _job->_done.wait(false, acquire);
+    }
+  }
 }
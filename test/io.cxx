@@ -0,0 +1,251 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+constexpr size_t FILE_COUNT = 64;
+constexpr size_t CHUNK_SIZE = 4096;
+
+static std::string temp_dir() {
+  std::string path = "/tmp/tasksys.io.XXXXXX";
+  if (!mkdtemp(path.data())) {
+    throw std::system_error(errno, std::system_category());
+  }
+  return path;
+}
+
+static task<bool> round_trip(scheduler &sch, const int dir, const std::string name, const uint8_t seed) {
+  co_await sch.schedule();
+
+  const auto fd = co_await async_openat(dir, name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+
+  std::vector<std::byte> out(CHUNK_SIZE);
+  for (size_t i = 0; i < out.size(); ++i) {
+    out[i] = static_cast<std::byte>(seed + i);
+  }
+
+  const auto written = co_await async_write(fd, out, 0);
+  co_await async_fsync(fd);
+
+  std::vector<std::byte> in(CHUNK_SIZE);
+  const auto read = co_await async_read(fd, in, 0);
+  const auto eof = co_await async_read(fd, in, CHUNK_SIZE);
+
+  ::close(fd);
+  co_return written == CHUNK_SIZE && read == CHUNK_SIZE && eof == 0 && in == out;
+}
+
+static task<size_t> round_trips(scheduler &sch, const int dir) {
+  std::vector<task<bool>> tasks;
+  for (size_t i = 0; i < FILE_COUNT; ++i) {
+    tasks.push_back(round_trip(sch, dir, std::to_string(i), static_cast<uint8_t>(i)));
+  }
+
+  size_t ok = 0;
+  for (auto &t : tasks) {
+    ok += co_await t;
+  }
+  co_return ok;
+}
+
+TEST(IoTest, RoundTrip) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  const auto path = temp_dir();
+  const auto dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+  ASSERT_GE(dir, 0);
+
+  EXPECT_EQ(sync_wait(round_trips(sch, dir)), FILE_COUNT);
+
+  ::close(dir);
+  std::filesystem::remove_all(path);
+  sch.stop(false);
+}
+
+TEST(IoTest, Synchronous) {
+  // no ring; every operation completes on awaiting thread
+  scheduler sch({.io_queue_depth = 0});
+  ASSERT_TRUE(sch.start());
+
+  const auto path = temp_dir();
+  const auto dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+
+  EXPECT_TRUE(sync_wait(round_trip(sch, dir, "file", 7)));
+  EXPECT_EQ(sch.io().ring(0), nullptr);
+  EXPECT_EQ(sch.aggregate().ring_fail, 0);
+
+  ::close(dir);
+  std::filesystem::remove_all(path);
+  sch.stop(false);
+}
+
+TEST(IoTest, LazyRings) {
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  // no I/O, no ring
+  sch.submit(job::create([](size_t) {}, {}, nullptr)).wait();
+  EXPECT_EQ(sch.io().ring(0), nullptr);
+
+  const auto path = temp_dir();
+  const auto dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+
+  EXPECT_TRUE(sync_wait(round_trip(sch, dir, "file", 3)));
+  EXPECT_NE(sch.io().ring(0) != nullptr, sch.stats()[0].ring_fail == 1);
+
+  ::close(dir);
+  std::filesystem::remove_all(path);
+  sch.stop(false);
+}
+
+TEST(IoTest, Fixed) {
+  scheduler sch({.worker_count = 2});
+
+  std::vector<std::byte> memory(CHUNK_SIZE * 2);
+  sch.io().register_buffers({std::span(memory).first(CHUNK_SIZE), std::span(memory).last(CHUNK_SIZE)});
+  ASSERT_TRUE(sch.start());
+
+  const auto path = temp_dir();
+  const auto dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY);
+
+  auto body = [](scheduler &sch, const int dir) -> task<bool> {
+    co_await sch.schedule();
+
+    const auto fd = co_await async_openat(dir, "fixed", O_CREAT | O_RDWR, 0600);
+    const auto out = sch.io().buffer(0);
+    const auto in = sch.io().buffer(1);
+    std::ranges::fill(out, std::byte{0x5a});
+
+    co_await async_write_fixed(fd, 0, out, 0);
+    const auto read = co_await async_read_fixed(fd, 1, in, 0);
+
+    ::close(fd);
+    co_return read == CHUNK_SIZE && std::ranges::equal(in, out);
+  };
+
+  EXPECT_TRUE(sync_wait(body(sch, dir)));
+
+  ::close(dir);
+  std::filesystem::remove_all(path);
+  sch.stop(false);
+}
+
+TEST(IoTest, Error) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  auto body = [](scheduler &sch) -> task<> {
+    co_await sch.schedule();
+    co_await async_openat(AT_FDCWD, "/nonexistent/tasksys", O_RDONLY);
+  };
+
+  EXPECT_THROW(sync_wait(body(sch)), std::system_error);
+  sch.stop(false);
+}
+
+TEST(IoTest, Spare) {
+  scheduler sch({.worker_count = 1, .spare_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+
+  auto read = [](const int fd) -> task<size_t> {
+    std::byte in[1];
+    co_return co_await async_read(fd, in, 0);
+  };
+
+  std::atomic_size_t read_size = 0;
+  std::atomic_bool read_done = false;
+  std::atomic_bool other_done = false;
+  bool overtaken = false;
+
+  const auto outer = job::create(
+    [&](size_t) {
+      sch.push(job::create(
+        [&](size_t) {
+          try {
+            read_size = sync_wait(read(fds[0]));
+          }
+          catch (const std::system_error &) {
+          }
+          read_done = true;
+        }, {}, nullptr
+      ));
+      sch.push(job::create([&](size_t) { other_done = true; }, {}, nullptr));
+
+      // spare takes both; pending read on its ring must not hold up the other job
+      sch.blocking([&] {
+        for (size_t i = 0; i < 500 && !other_done; ++i) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        overtaken = other_done && !read_done;
+
+        const std::byte out[1] = {std::byte{1}};
+        EXPECT_EQ(::write(fds[1], out, 1), 1);
+        for (size_t i = 0; i < 500 && !read_done; ++i) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      });
+    }, {}, nullptr
+  );
+
+  sch.submit(outer).wait();
+  EXPECT_TRUE(overtaken);
+  EXPECT_EQ(read_size.load(), 1);
+  EXPECT_NE(sch.io().ring(1), nullptr);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+  sch.stop(false);
+}
+
+TEST(IoTest, StopCancelsInFlight) {
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+
+  std::atomic_bool reading = false;
+  auto body = [](scheduler &sch, const int fd, std::atomic_bool &reading) -> task<size_t> {
+    co_await sch.schedule();
+
+    std::byte in[1];
+    reading = true;
+    reading.notify_one();
+    co_return co_await async_read(fd, in, 0);
+  };
+
+  // nothing is ever written; only stop can end the read
+  int error = 0;
+  std::thread waiter([&] {
+    try {
+      sync_wait(body(sch, fds[0], reading));
+    }
+    catch (const std::system_error &e) {
+      error = e.code().value();
+    }
+  });
+
+  reading.wait(false);
+  sch.stop(false);
+  waiter.join();
+  ::close(fds[0]);
+  ::close(fds[1]);
+
+  if (!sch.io().ring(0)) {
+    GTEST_SKIP() << "io_uring unavailable";
+  }
+  EXPECT_EQ(error, ECANCELED);
+}
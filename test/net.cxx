@@ -0,0 +1,155 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+using namespace std::chrono_literals;
+
+constexpr size_t CLIENT_COUNT = 32;
+constexpr size_t MESSAGE_COUNT = 64;
+constexpr size_t STREAM_SIZE = 1024 * 1024 * 4;
+
+static task<size_t> recv_exact(async_socket &socket, std::span<std::byte> buffer) {
+  size_t total = 0;
+  while (total < buffer.size()) {
+    const auto n = co_await async_recv(socket, buffer.subspan(total));
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  co_return total;
+}
+
+static task<> send_all(async_socket &socket, std::span<const std::byte> buffer) {
+  while (!buffer.empty()) {
+    buffer = buffer.subspan(co_await async_send(socket, buffer));
+  }
+}
+
+static task<> echo(scheduler &sch, async_socket &listener) {
+  co_await sch.schedule();
+
+  for (size_t i = 0; i < CLIENT_COUNT; ++i) {
+    auto peer = co_await async_accept(listener);
+
+    std::array<std::byte, sizeof(size_t)> message;
+    while (co_await recv_exact(peer, message) == message.size()) {
+      co_await send_all(peer, message);
+    }
+  }
+}
+
+static task<size_t> client(scheduler &sch, const sockaddr_in address, const size_t id) {
+  co_await sch.schedule();
+
+  async_socket socket(sch.poller(), ::socket(AF_INET, SOCK_STREAM, 0));
+  co_await async_connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+
+  size_t ok = 0;
+  for (size_t i = 0; i < MESSAGE_COUNT; ++i) {
+    const auto value = id * MESSAGE_COUNT + i;
+    co_await send_all(socket, std::as_bytes(std::span(&value, 1)));
+
+    size_t reply = 0;
+    co_await recv_exact(socket, std::as_writable_bytes(std::span(&reply, 1)));
+    ok += reply == value;
+  }
+  co_return ok;
+}
+
+TEST(NetTest, TcpEcho) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  async_socket listener(sch.poller(), ::socket(AF_INET, SOCK_STREAM, 0));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t size = sizeof(address);
+  ASSERT_EQ(bind(listener.fd(), reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+  ASSERT_EQ(listen(listener.fd(), CLIENT_COUNT), 0);
+  ASSERT_EQ(getsockname(listener.fd(), reinterpret_cast<sockaddr*>(&address), &size), 0);
+
+  std::thread server([&sch, &listener] { sync_wait(echo(sch, listener)); });
+
+  // clients run one after another; server handles them in accept order
+  for (size_t i = 0; i < CLIENT_COUNT; ++i) {
+    EXPECT_EQ(sync_wait(client(sch, address, i)), MESSAGE_COUNT);
+  }
+
+  server.join();
+  sch.stop(false);
+}
+
+TEST(NetTest, WakesParkedWorkers) {
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  async_socket socket(sch.poller(), fds[0]);
+
+  std::thread writer([fd = fds[1]] {
+    // long enough for every worker to park
+    std::this_thread::sleep_for(50ms);
+    const char message = 'x';
+    EXPECT_EQ(::send(fd, &message, 1, 0), 1);
+  });
+
+  auto body = [](scheduler &sch, async_socket &socket) -> task<size_t> {
+    co_await sch.schedule();
+
+    std::array<std::byte, 16> buffer;
+    co_return co_await async_recv(socket, buffer);
+  };
+
+  EXPECT_EQ(sync_wait(body(sch, socket)), 1);
+
+  writer.join();
+  ::close(fds[1]);
+  sch.stop(false);
+}
+
+TEST(NetTest, Stream) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  async_socket in(sch.poller(), fds[0]);
+  async_socket out(sch.poller(), fds[1]);
+
+  std::vector<std::byte> sent(STREAM_SIZE);
+  for (size_t i = 0; i < sent.size(); ++i) {
+    sent[i] = static_cast<std::byte>(i * 31);
+  }
+
+  // far more than socket buffer; sender waits for writable edges
+  std::thread sender([&sch, &out, &sent] {
+    auto body = [](scheduler &sch, async_socket &out, const std::vector<std::byte> &sent) -> task<> {
+      co_await sch.schedule();
+      co_await send_all(out, sent);
+      out.close();
+    };
+    sync_wait(body(sch, out, sent));
+  });
+
+  auto body = [](scheduler &sch, async_socket &in) -> task<std::vector<std::byte>> {
+    co_await sch.schedule();
+
+    std::vector<std::byte> received(STREAM_SIZE);
+    received.resize(co_await recv_exact(in, received));
+    co_return received;
+  };
+
+  EXPECT_EQ(sync_wait(body(sch, in)), sent);
+
+  sender.join();
+  sch.stop(false);
+}
@@ -5,6 +5,7 @@
 #include <vector>
 #include <gtest/gtest.h>
 
+#include "ts/mailbox.h"
 #include "ts/queue.h"
 
 using namespace ts;
@@ -61,7 +62,9 @@ TEST(FAATest, BasicPushPop) {
 
 TEST(FAATest, FullAndEmpty) {
   vyukov<int> q(2);
+  EXPECT_TRUE(q.empty());
   EXPECT_TRUE(q.push(1));
+  EXPECT_FALSE(q.empty());
   EXPECT_TRUE(q.push(2));
 
   // Queue is full. Note: MPMC fullness is racy, so we check
@@ -74,6 +77,7 @@ TEST(FAATest, FullAndEmpty) {
 
   // Queue is empty
   EXPECT_FALSE(q.pop().has_value());
+  EXPECT_TRUE(q.empty());
 }
 
 TEST(FAATest, Integrity) {
@@ -137,6 +141,99 @@ TEST(FAATest, Integrity) {
   }
 }
 
+TEST(FAATest, PushBulk) {
+  vyukov<int> q(8);
+  EXPECT_TRUE(q.push(0));
+  EXPECT_TRUE(q.push(1));
+  EXPECT_TRUE(q.push(2));
+
+  // only five slots left
+  std::array<int, 10> items{};
+  std::iota(items.begin(), items.end(), 3);
+  EXPECT_EQ(q.push_bulk(items.data(), items.size()), 5);
+  EXPECT_EQ(q.push_bulk(items.data(), items.size()), 0);
+  EXPECT_FALSE(q.push(100));
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(q.pop(), i);
+  }
+  EXPECT_FALSE(q.pop().has_value());
+
+  EXPECT_EQ(q.push_bulk(items.data(), 4), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(q.pop(), i + 3);
+  }
+}
+
+TEST(FAATest, BulkIntegrity) {
+  static constexpr size_t QUEUE_SIZE = 128;
+  static constexpr size_t BULK_SIZE = 48;
+  static constexpr size_t PRODUCER_COUNT = THREAD_COUNT / 2;
+  static constexpr size_t ITEM_COUNT = BASE_ITEM_COUNT / 16;
+  static constexpr size_t PRODUCER_SIZE = ITEM_COUNT / PRODUCER_COUNT;
+
+  vyukov<size_t> q(QUEUE_SIZE);
+
+  std::vector<std::jthread> writers;
+  writers.reserve(PRODUCER_COUNT);
+  for (size_t i = 0; i < PRODUCER_COUNT; ++i) {
+    const auto ci = i;
+    writers.emplace_back(
+      [&q, ci] {
+        std::array<size_t, BULK_SIZE> items{};
+        for (size_t item = 0; item < PRODUCER_SIZE;) {
+          const auto count = std::min(BULK_SIZE, PRODUCER_SIZE - item);
+          std::iota(items.begin(), items.begin() + count, item + ci * PRODUCER_SIZE);
+
+          item += q.push_bulk(items.data(), count);
+          std::this_thread::yield();
+        }
+      }
+    );
+  }
+
+  std::atomic_size_t consumed = 0;
+  std::array<std::vector<size_t>, THREAD_COUNT> buffer;
+
+  std::vector<std::jthread> readers;
+  readers.reserve(THREAD_COUNT);
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    const auto ci = i;
+    readers.emplace_back(
+      [&q, &buffer, &consumed, ci] {
+        while (consumed.load() < ITEM_COUNT) {
+          if (auto v = q.pop()) {
+            buffer[ci].push_back(v.value());
+            ++consumed;
+          }
+          else {
+            std::this_thread::yield();
+          }
+        }
+      }
+    );
+  }
+
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  std::set<size_t> check;
+  for (const auto &b : buffer) {
+    for (auto v : b) {
+      const auto [_, inserted] = check.insert(v);
+      EXPECT_TRUE(inserted) << "duplication found: " << v;
+    }
+  }
+
+  for (size_t i = 0; i < ITEM_COUNT; ++i) {
+    EXPECT_TRUE(check.contains(i)) << "missing found: " << i;
+  }
+}
+
 
 // --- Test ts::chaselev ---
 // (Single Owner (push/take), Multi-Stealer (steal))
@@ -184,6 +281,34 @@ TEST(ChaseLevTest, FullAndEmpty) {
   EXPECT_FALSE(d.take().has_value());
 }
 
+TEST(ChaseLevTest, TakeFromFresh) {
+  chaselev<int> d(2);
+  EXPECT_FALSE(d.take().has_value());
+  EXPECT_FALSE(d.steal().has_value());
+
+  // deque must stay usable after underflowing take
+  EXPECT_TRUE(d.try_push(1));
+  EXPECT_TRUE(d.try_push(2));
+  EXPECT_EQ(d.take().value(), 2);
+  EXPECT_EQ(d.steal().value(), 1);
+  EXPECT_FALSE(d.take().has_value());
+}
+
+TEST(ChaseLevTest, Size) {
+  chaselev<int> d(8);
+  EXPECT_TRUE(d.empty());
+
+  d.push(1);
+  d.push(2);
+  EXPECT_EQ(d.size(), 2);
+
+  EXPECT_TRUE(d.steal().has_value());
+  EXPECT_EQ(d.size(), 1);
+
+  EXPECT_TRUE(d.take().has_value());
+  EXPECT_TRUE(d.empty());
+}
+
 TEST(ChaseLevTest, RaceOnLastItem) {
   chaselev<int> d(8);
   d.push(100);
@@ -273,3 +398,249 @@ TEST(ChaseLevTest, OneOwnerManyStealers) {
     EXPECT_TRUE(check.contains(i)) << "missing found: " << i;
   }
 }
+
+TEST(ChaseLevTest, StealHalf) {
+  chaselev<int> d(16);
+  chaselev<int> into(16);
+  for (int i = 0; i < 10; ++i) {
+    d.push(i);
+  }
+
+  // oldest item is returned, rest of oldest half goes to `into`
+  EXPECT_EQ(d.steal_half(into).value(), 0);
+  EXPECT_EQ(d.size(), 5);
+  EXPECT_EQ(into.size(), 4);
+  for (int i = 1; i < 5; ++i) {
+    EXPECT_EQ(into.steal().value(), i);
+  }
+
+  chaselev<int> single(2);
+  single.push(42);
+  EXPECT_EQ(single.steal_half(into).value(), 42);
+  EXPECT_TRUE(into.empty());
+  EXPECT_FALSE(single.steal_half(into).has_value());
+}
+
+TEST(ChaseLevTest, Shrink) {
+  chaselev<int> d(16);
+  for (int i = 0; i < 1024 * 64; ++i) {
+    d.push(i);
+  }
+  EXPECT_EQ(d.capacity(), 1024 * 64);
+
+  while (d.take()) {
+  }
+
+  // halves once per interval of empty takes, down to initial capacity
+  for (size_t i = 0; i < CHASELEV_SHRINK_INTERVAL * 16; ++i) {
+    EXPECT_FALSE(d.take().has_value());
+  }
+  EXPECT_EQ(d.capacity(), 16);
+
+  d.push(7);
+  EXPECT_EQ(d.steal().value(), 7);
+}
+
+TEST(ChaseLevTest, BurstsWithStealers) {
+  static constexpr size_t BURST_COUNT = 64;
+  static constexpr size_t BURST_SIZE = 1024 * 4;
+
+  chaselev<size_t> d(2);
+
+  std::atomic_flag done = ATOMIC_FLAG_INIT;
+  std::atomic_size_t sum = 0;
+
+  std::vector<std::jthread> stealers;
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    stealers.emplace_back([&d, &done, &sum] {
+      chaselev<size_t> into(2);
+      while (!done.test()) {
+        if (const auto v = d.steal_half(into)) {
+          sum += v.value();
+        }
+        while (const auto v = into.take()) {
+          sum += v.value();
+        }
+      }
+    });
+  }
+
+  // every burst grows deque from scratch; empty takes in between shrink it again
+  size_t expected = 0;
+  for (size_t b = 0; b < BURST_COUNT; ++b) {
+    for (size_t i = 1; i <= BURST_SIZE; ++i) {
+      d.push(i);
+      expected += i;
+    }
+    while (const auto v = d.take()) {
+      sum += v.value();
+    }
+    for (size_t i = 0; i < CHASELEV_SHRINK_INTERVAL * 4; ++i) {
+      if (const auto v = d.take()) {
+        sum += v.value();
+      }
+    }
+  }
+
+  done.test_and_set();
+  stealers.clear();
+
+  EXPECT_EQ(sum.load(), expected);
+}
+
+TEST(ChaseLevTest, OneOwnerManyHalfStealers) {
+  static constexpr size_t QUEUE_SIZE = 128;
+  static constexpr size_t ITEM_COUNT = BASE_ITEM_COUNT / 4;
+
+  chaselev<size_t> d(QUEUE_SIZE);
+
+  std::atomic_size_t consumed = 0;
+  std::array<std::vector<size_t>, THREAD_COUNT + 1> buffer;
+
+  std::jthread owner(
+    [&d, &consumed, &buffer] {
+      for (size_t i = 0; i < ITEM_COUNT; i++) {
+        d.push(i);
+
+        if (i % 4 == 0) {
+          if (auto v = d.take()) {
+            buffer[THREAD_COUNT].push_back(v.value());
+            consumed.fetch_add(1, std::memory_order_acq_rel);
+          }
+        }
+      }
+
+      while (auto v = d.take()) {
+        buffer[THREAD_COUNT].push_back(v.value());
+        consumed.fetch_add(1, std::memory_order_acq_rel);
+      }
+    }
+  );
+
+  std::vector<std::jthread> thieves;
+  thieves.reserve(THREAD_COUNT);
+  for (size_t i = 0; i < THREAD_COUNT; ++i) {
+    const auto ci = i;
+    thieves.emplace_back(
+      [&d, &consumed, &buffer, ci] {
+        chaselev<size_t> local(QUEUE_SIZE);
+
+        while (consumed.load(acquire) < ITEM_COUNT) {
+          if (const auto v = d.steal_half(local)) {
+            buffer[ci].push_back(v.value());
+            consumed.fetch_add(1, std::memory_order_acq_rel);
+          }
+          while (const auto v = local.take()) {
+            buffer[ci].push_back(v.value());
+            consumed.fetch_add(1, std::memory_order_acq_rel);
+          }
+
+          std::this_thread::yield();
+        }
+      }
+    );
+  }
+
+  owner.join();
+  for (auto &thief : thieves) {
+    thief.join();
+  }
+
+  std::set<size_t> check;
+  for (const auto &b : buffer) {
+    for (const auto v : b) {
+      const auto [_, inserted] = check.insert(v);
+      EXPECT_TRUE(inserted) << "duplication found: " << v;
+    }
+  }
+
+  for (size_t i = 0; i < ITEM_COUNT; ++i) {
+    EXPECT_TRUE(check.contains(i)) << "missing found: " << i;
+  }
+}
+
+TEST(MailboxTest, ProducerOrder) {
+  static constexpr size_t PRODUCER_COUNT = 4;
+  static constexpr size_t ITEM_COUNT = 1024 * 16;
+
+  ts::mailbox box;
+  // set by each job when called; index is producer * ITEM_COUNT + sequence
+  size_t index = 0;
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < PRODUCER_COUNT; ++p) {
+    producers.emplace_back([&box, &index, p] {
+      for (size_t i = 0; i < ITEM_COUNT; ++i) {
+        const auto begin = p * ITEM_COUNT + i;
+        box.push(ts::job::create([&index](const size_t i) { index = i; }, {begin, begin + 1}, nullptr));
+      }
+    });
+  }
+
+  std::array<size_t, PRODUCER_COUNT> next{};
+  size_t received = 0;
+  bool ordered = true;
+  while (received < PRODUCER_COUNT * ITEM_COUNT) {
+    const auto job = box.pop();
+    if (!job) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    (void) job->call([](ts::job *) {});
+    ordered = ordered && index % ITEM_COUNT == next[index / ITEM_COUNT]++;
+    received++;
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(box.empty());
+}
+
+TEST(SpscTest, FullAndEmpty) {
+  ts::spsc<size_t> ring(4);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_FALSE(ring.pop().has_value());
+
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.push(i));
+  }
+  EXPECT_FALSE(ring.push(4));
+
+  EXPECT_EQ(ring.pop(), 0);
+  EXPECT_TRUE(ring.push(4));
+  for (size_t i = 1; i < 5; ++i) {
+    EXPECT_EQ(ring.pop(), i);
+  }
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscTest, Order) {
+  ts::spsc<size_t> ring(256);
+
+  std::thread producer([&ring] {
+    for (size_t i = 0; i < BASE_ITEM_COUNT; ++i) {
+      while (!ring.push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  bool ordered = true;
+  for (size_t next = 0; next < BASE_ITEM_COUNT;) {
+    if (const auto opt = ring.pop()) {
+      ordered = ordered && opt.value() == next;
+      next++;
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+
+  producer.join();
+  EXPECT_TRUE(ordered);
+  EXPECT_TRUE(ring.empty());
+}
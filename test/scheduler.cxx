@@ -1,3 +1,4 @@
+#include <array>
 #include <gtest/gtest.h>
 
 #include "ts/ts.h"
@@ -49,3 +50,634 @@ TEST(Scheduler, Integrity) {
     EXPECT_TRUE(check.contains(i)) << "missing found: " << i;
   }
 }
+
+TEST(Scheduler, Handle) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+
+  const auto handle = sch.submit(
+    job::create([&counter](size_t) { ++counter; }, {0, BASE_ITEM_COUNT}, nullptr)
+  );
+  handle.wait();
+
+  EXPECT_TRUE(handle.done());
+  EXPECT_EQ(counter.load(), BASE_ITEM_COUNT);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, HandleWithChildren) {
+  static constexpr size_t CHILD_COUNT = 64;
+
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+  std::atomic_size_t observed = 0;
+
+  const auto parent = job::create(
+    [&counter, &observed](size_t) { observed = counter.load(); }, {}, nullptr
+  );
+  const auto handle = parent->watch();
+
+  std::vector<job*> children;
+  for (size_t i = 0; i < CHILD_COUNT; ++i) {
+    children.push_back(job::create([&counter](size_t) { ++counter; }, {0, 1024}, parent));
+  }
+  for (const auto child : children) {
+    sch.push(child);
+  }
+
+  handle.wait();
+  EXPECT_EQ(observed.load(), CHILD_COUNT * 1024);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, NestedWait) {
+  static constexpr size_t OUTER_COUNT = 256;
+  static constexpr size_t INNER_COUNT = 1024;
+
+  // far more waiting jobs than workers; blocking waits would deadlock
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+
+  const auto handle = sch.submit(
+    job::create(
+      [&sch, &counter](size_t) {
+        const auto inner = sch.submit(
+          job::create([&counter](size_t) { ++counter; }, {0, INNER_COUNT}, nullptr)
+        );
+        inner.wait();
+      }, {0, OUTER_COUNT, 1}, nullptr
+    )
+  );
+  handle.wait();
+
+  EXPECT_EQ(counter.load(), OUTER_COUNT * INNER_COUNT);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, SharedCallback) {
+  struct counting {
+    std::atomic_size_t *counter;
+    std::atomic_size_t *copies;
+
+    counting(std::atomic_size_t *counter, std::atomic_size_t *copies) : counter(counter), copies(copies) {
+    }
+
+    counting(const counting &other) : counter(other.counter), copies(other.copies) {
+      ++*copies;
+    }
+
+    counting(counting &&other) noexcept = default;
+
+    void operator()(size_t) const {
+      ++*counter;
+    }
+  };
+
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+  std::atomic_size_t copies = 0;
+
+  sch.submit(job::create(counting(&counter, &copies), {0, BASE_ITEM_COUNT}, nullptr)).wait();
+
+  // pieces refer to callable of origin; splitting never copies it
+  EXPECT_EQ(counter.load(), BASE_ITEM_COUNT);
+  EXPECT_EQ(copies.load(), 0);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, LargeCallback) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::array<size_t, JOB_INLINE_SIZE> weights{};
+  weights.fill(1);
+
+  std::atomic_size_t counter = 0;
+
+  sch.submit(
+    job::create(
+      [&counter, weights](const size_t i) { counter += weights[i % weights.size()]; },
+      {0, BASE_ITEM_COUNT}, nullptr
+    )
+  ).wait();
+
+  EXPECT_EQ(counter.load(), BASE_ITEM_COUNT);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, LazyIntegrity) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::vector<std::vector<size_t>> buffers(sch.config().worker_count);
+
+  sch.submit(
+    job::create(
+      [&buffers](const size_t i) { buffers[worker::current()->id()].push_back(i); },
+      {0, BASE_ITEM_COUNT, 8, split_mode::lazy}, nullptr
+    )
+  ).wait();
+
+  sch.stop(false);
+
+  std::set<size_t> check;
+  for (const auto &buffer : buffers) {
+    for (auto i : buffer) {
+      auto [_, b] = check.insert(i);
+      EXPECT_TRUE(b) << "duplication found: " << i;
+    }
+  }
+
+  for (size_t i = 0; i < BASE_ITEM_COUNT; ++i) {
+    EXPECT_TRUE(check.contains(i)) << "missing found: " << i;
+  }
+}
+
+TEST(Scheduler, LazyUnevenSplit) {
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  // first split keeps 3 of 5 items, less than one batch
+  std::atomic_size_t sum = 0;
+  sch.submit(job::create([&sum](const size_t i) { sum += i; }, {0, 5, 4, split_mode::lazy}, nullptr)).wait();
+  EXPECT_EQ(sum.load(), 10);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, LocalPushWakesParked) {
+  static constexpr size_t WORKER_COUNT = 4;
+
+  scheduler sch({.worker_count = WORKER_COUNT});
+  ASSERT_TRUE(sch.start());
+
+  // let every worker run out of spins and park
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // each index holds its worker until all are running at once;
+  // pieces reach other workers only through local deque of first one
+  std::atomic_size_t arrived = 0;
+  std::atomic_bool timeout = false;
+
+  sch.submit(
+    job::create(
+      [&arrived, &timeout](size_t) {
+        ++arrived;
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (arrived.load() < WORKER_COUNT) {
+          if (std::chrono::steady_clock::now() > deadline) {
+            timeout = true;
+            break;
+          }
+          std::this_thread::yield();
+        }
+      }, {0, WORKER_COUNT, 1}, nullptr
+    )
+  ).wait();
+
+  EXPECT_FALSE(timeout.load());
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, PushBatch) {
+  static constexpr size_t JOB_COUNT = 1024 * 64;
+
+  // global queue smaller than batch; bulk push must fall back
+  scheduler sch({.worker_count = 2, .global_queue_size = 1024});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+
+  const auto parent = job::create([](size_t) {}, {}, nullptr);
+  const auto handle = parent->watch();
+
+  std::vector<job*> jobs;
+  jobs.reserve(JOB_COUNT);
+  for (size_t i = 0; i < JOB_COUNT; ++i) {
+    jobs.push_back(job::create([&counter](size_t) { ++counter; }, {}, parent));
+  }
+
+  sch.push_batch(jobs);
+  handle.wait();
+
+  EXPECT_EQ(counter.load(), JOB_COUNT);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, Stats) {
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  // eager halving of 1024 indices by 8 leaves 128 pieces
+  sch.submit(job::create([](size_t) {}, {0, 1024, 8}, nullptr)).wait();
+  sch.stop(false);
+
+  const auto stats = sch.stats();
+  ASSERT_EQ(stats.size(), 2);
+
+  const auto total = sch.aggregate();
+  EXPECT_EQ(total.run, 128);
+  EXPECT_EQ(total.split, 127);
+  EXPECT_GE(total.local + total.steal + total.global, 1);
+
+  const auto text = to_prometheus(stats);
+  EXPECT_NE(text.find("# TYPE tasksys_runs_total counter"), std::string::npos);
+  EXPECT_NE(text.find("tasksys_runs_total{worker=\"1\"}"), std::string::npos);
+}
+
+TEST(Scheduler, PriorityOrder) {
+  static constexpr size_t LOW_COUNT = 64;
+
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_flag release = ATOMIC_FLAG_INIT;
+  std::atomic_size_t order = 0;
+  size_t high_order = 0;
+
+  // keep only worker busy until everything is queued
+  sch.push(job::create([&release](size_t) { release.wait(false); }, {}, nullptr));
+
+  const auto parent = job::create([](size_t) {}, {}, nullptr);
+  const auto handle = parent->watch();
+  for (size_t i = 0; i < LOW_COUNT; ++i) {
+    sch.push(job::create([&order](size_t) { ++order; }, {.priority = job_priority::low}, parent));
+  }
+  sch.push(job::create([&order, &high_order](size_t) { high_order = order++; }, {.priority = job_priority::high}, parent));
+
+  release.test_and_set();
+  release.notify_all();
+  handle.wait();
+
+  // starvation guard may let one lower job go first
+  EXPECT_LE(high_order, 1);
+  EXPECT_EQ(order.load(), LOW_COUNT + 1);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, PriorityStarvationGuard) {
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_flag low_done = ATOMIC_FLAG_INIT;
+  std::atomic_size_t high_count = 0;
+
+  std::jthread flood([&sch, &low_done, &high_count] {
+    while (!low_done.test()) {
+      sch.push(job::create([&high_count](size_t) { ++high_count; }, {.priority = job_priority::high}, nullptr));
+    }
+  });
+
+  sch.submit(job::create([&low_done](size_t) { low_done.test_and_set(); }, {.priority = job_priority::low}, nullptr)).wait();
+  flood.join();
+
+  EXPECT_TRUE(low_done.test());
+
+  sch.stop(true);
+}
+
+TEST(Scheduler, SplitKeepsPriority) {
+  size_t sum = 0;
+  const auto job = job::create([&sum](const size_t i) { sum += i; }, {0, 16, 8, split_mode::eager, job_priority::low}, nullptr);
+
+  const auto right = job->split(8);
+  EXPECT_EQ(right->priority(), job_priority::low);
+
+  EXPECT_FALSE(right->call([](ts::job *) {}));
+  EXPECT_FALSE(job->call([](ts::job *) {}));
+  EXPECT_EQ(sum, 120);
+}
+
+TEST(Scheduler, Diamond) {
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t step = 0;
+  size_t a = 0, b = 0, c = 0, d = 0;
+
+  const auto ja = job::create([&](size_t) { a = ++step; }, {}, nullptr);
+  const auto jb = job::create([&](size_t) { b = ++step; }, {}, nullptr);
+  const auto jc = job::create([&](size_t) { c = ++step; }, {}, nullptr);
+  const auto jd = job::create([&](size_t) { d = ++step; }, {}, nullptr);
+
+  ja->precede(jb);
+  ja->precede(jc);
+  jb->precede(jd);
+  jc->precede(jd);
+
+  const auto handle = jd->watch();
+  sch.push(ja);
+  handle.wait();
+
+  EXPECT_EQ(a, 1);
+  EXPECT_LT(a, b);
+  EXPECT_LT(a, c);
+  EXPECT_EQ(d, 4);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, Pipeline) {
+  static constexpr size_t STAGE_COUNT = 8;
+  static constexpr size_t STAGE_WIDTH = 16;
+
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  std::array<std::atomic_size_t, STAGE_COUNT> finished{};
+  std::atomic_flag violated = ATOMIC_FLAG_INIT;
+
+  // every job of stage waits for all jobs of previous stage
+  std::vector<job*> previous;
+  std::vector<job*> first;
+  for (size_t s = 0; s < STAGE_COUNT; ++s) {
+    std::vector<job*> stage;
+    for (size_t i = 0; i < STAGE_WIDTH; ++i) {
+      const auto job = job::create([&finished, &violated, s](size_t) {
+        if (s > 0 && finished[s - 1].load() != STAGE_WIDTH) {
+          violated.test_and_set();
+        }
+        ++finished[s];
+      }, {}, nullptr);
+
+      for (const auto predecessor : previous) {
+        predecessor->precede(job);
+      }
+      stage.push_back(job);
+    }
+
+    if (s == 0) {
+      first = stage;
+    }
+    previous = std::move(stage);
+  }
+
+  const auto sink = job::create([](size_t) {}, {}, nullptr);
+  for (const auto predecessor : previous) {
+    predecessor->precede(sink);
+  }
+
+  const auto handle = sink->watch();
+  sch.push_batch(first);
+  handle.wait();
+
+  EXPECT_FALSE(violated.test());
+  for (const auto &count : finished) {
+    EXPECT_EQ(count.load(), STAGE_WIDTH);
+  }
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, CancelRange) {
+  static constexpr size_t RANGE_SIZE = 1024 * 1024;
+
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  for (const auto split : {split_mode::eager, split_mode::lazy}) {
+    cancel_source source;
+    std::atomic_size_t counter = 0;
+
+    sch.submit(
+      job::create(
+        [&source, &counter](size_t) {
+          if (++counter == 1024) {
+            source.cancel();
+          }
+        },
+        {0, RANGE_SIZE, 64, split, job_priority::normal, source.token()}, nullptr
+      )
+    ).wait();
+
+    EXPECT_GE(counter.load(), 1024);
+    EXPECT_LT(counter.load(), RANGE_SIZE);
+  }
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, CancelTree) {
+  static constexpr size_t CHILD_COUNT = 64;
+
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  cancel_source source;
+  std::atomic_size_t counter = 0;
+
+  // children inherit token of parent
+  const auto parent = job::create([&counter](size_t) { ++counter; }, {.cancel = source.token()}, nullptr);
+  const auto handle = parent->watch();
+
+  std::vector<job*> children;
+  for (size_t i = 0; i < CHILD_COUNT; ++i) {
+    children.push_back(job::create([&counter](size_t) { ++counter; }, {0, 1024}, parent));
+  }
+
+  source.cancel();
+  sch.push_batch(children);
+
+  // parent is still released and completes
+  handle.wait();
+  EXPECT_EQ(counter.load(), 0);
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, PushToPinned) {
+  static constexpr size_t WORKER_COUNT = 4;
+
+  scheduler sch({.worker_count = WORKER_COUNT});
+  ASSERT_TRUE(sch.start());
+
+  std::array<std::atomic_size_t, WORKER_COUNT> strays{};
+  std::vector<handle> handles;
+
+  for (size_t round = 0; round < 64; ++round) {
+    for (size_t id = 0; id < WORKER_COUNT; ++id) {
+      const auto pinned = job::create(
+        [&strays, id](size_t) {
+          if (worker::current()->id() != id) {
+            ++strays[id];
+          }
+        }, {.begin = 0, .end = 1024, .batch_size = 4, .stealable = false}, nullptr
+      );
+
+      handles.push_back(pinned->watch());
+      sch.push_to(id, pinned);
+    }
+  }
+
+  for (const auto &done : handles) {
+    done.wait();
+  }
+
+  for (size_t id = 0; id < WORKER_COUNT; ++id) {
+    EXPECT_EQ(strays[id].load(), 0) << "worker " << id;
+  }
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, PushToWakesTarget) {
+  static constexpr size_t WORKER_COUNT = 4;
+
+  scheduler sch({.worker_count = WORKER_COUNT});
+  ASSERT_TRUE(sch.start());
+
+  for (size_t id = 0; id < WORKER_COUNT; ++id) {
+    // let every worker run out of spins and park
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::atomic_size_t ran = -1;
+    const auto pinned = job::create(
+      [&ran](size_t) { ran = worker::current()->id(); }, {.stealable = false}, nullptr
+    );
+
+    const auto done = pinned->watch();
+    sch.push_to(id, pinned);
+    done.wait();
+
+    EXPECT_EQ(ran.load(), id);
+  }
+
+  sch.stop(false);
+}
+
+TEST(Scheduler, PushToFlushed) {
+  scheduler sch({.worker_count = 2});
+
+  // not started; flush runs them on calling thread
+  std::atomic_size_t ran = 0;
+  for (size_t i = 0; i < 16; ++i) {
+    sch.push_to(i % 2, job::create([&ran](size_t) { ++ran; }, {}, nullptr));
+  }
+
+  sch.stop(true);
+  EXPECT_EQ(ran.load(), 16);
+}
+
+TEST(Scheduler, BlockingHandsOff) {
+  static constexpr size_t CHILD_COUNT = 16;
+
+  scheduler sch({.worker_count = 1, .spare_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  EXPECT_EQ(sch.blocking([] { return 42; }), 42);
+
+  std::atomic_size_t ran = 0;
+  std::atomic_size_t strays = 0;
+  size_t seen = 0;
+
+  const auto outer = job::create(
+    [&](size_t) {
+      for (size_t i = 0; i < CHILD_COUNT; ++i) {
+        sch.push(job::create(
+          [&](size_t) {
+            strays += worker::current()->id() != 1;
+            ++ran;
+          }, {}, nullptr
+        ));
+      }
+
+      // only worker is stuck here; children must run on spare
+      seen = sch.blocking([&ran] {
+        for (size_t i = 0; i < 500 && ran < CHILD_COUNT; ++i) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return ran.load();
+      });
+    }, {}, nullptr
+  );
+
+  sch.submit(outer).wait();
+  EXPECT_EQ(seen, CHILD_COUNT);
+  EXPECT_EQ(strays.load(), 0);
+
+  // retired spare takes nothing new
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::atomic_size_t spared = 0;
+  const auto after = job::create(
+    [&spared](size_t) { spared += worker::current()->id() != 0; },
+    {.begin = 0, .end = 1024, .batch_size = 1}, nullptr
+  );
+  sch.submit(after).wait();
+  EXPECT_EQ(spared.load(), 0);
+
+  EXPECT_EQ(sch.stats().size(), 1);
+  sch.stop(false);
+}
+
+TEST(Scheduler, Producers) {
+  static constexpr size_t PRODUCER_COUNT = 6;
+  static constexpr size_t JOB_COUNT = 1024 * 16;
+
+  // two producers more than feeds; they go through global queue
+  scheduler sch({.worker_count = 4, .producer_count = 4, .producer_queue_size = 64});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t sum = 0;
+  std::atomic_size_t attached = 0;
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < PRODUCER_COUNT; ++p) {
+    threads.emplace_back([&sch, &sum, &attached] {
+      auto feed = sch.attach();
+      attached += feed.attached();
+
+      std::vector<handle> handles;
+      for (size_t i = 0; i < JOB_COUNT; ++i) {
+        const auto priority = i % 64 == 0 ? job_priority::high : job_priority::normal;
+        const auto counted = job::create([&sum, i](size_t) { sum += i; }, {.priority = priority}, nullptr);
+        handles.push_back(counted->watch());
+        feed.push(counted);
+      }
+
+      for (const auto &done : handles) {
+        done.wait();
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_LE(attached.load(), 4);
+  EXPECT_EQ(sum.load(), PRODUCER_COUNT * (JOB_COUNT * (JOB_COUNT - 1) / 2));
+  sch.stop(false);
+}
+
+TEST(Scheduler, ProducerFlushed) {
+  scheduler sch({.worker_count = 1});
+
+  // not started; flush runs them on calling thread
+  std::atomic_size_t ran = 0;
+  {
+    auto feed = sch.attach();
+    ASSERT_TRUE(feed.attached());
+    for (size_t i = 0; i < 8; ++i) {
+      feed.push(job::create([&ran](size_t) { ++ran; }, {}, nullptr));
+    }
+  }
+
+  sch.stop(true);
+  EXPECT_EQ(ran.load(), 8);
+}
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+struct item {
+  size_t value;
+  size_t padding[5];
+
+  explicit item(const size_t value) : value(value), padding{} {
+  }
+};
+
+// --- Test ts::slab ---
+
+TEST(SlabTest, ReuseLocal) {
+  const auto a = slab<item>::rent(1);
+  EXPECT_EQ(a->value, 1);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % CACHELINE_SIZE, 0);
+
+  slab<item>::yield(a);
+  const auto b = slab<item>::rent(2);
+  EXPECT_EQ(a, b);
+
+  slab<item>::yield(b);
+}
+
+TEST(SlabTest, RemoteFreeReturnsToOwner) {
+  static constexpr size_t ITEM_COUNT = 1024;
+
+  std::vector<item*> items;
+  for (size_t i = 0; i < ITEM_COUNT; ++i) {
+    items.push_back(slab<item>::rent(i));
+  }
+  const std::set<item*> rented(items.begin(), items.end());
+  const auto capacity = slab<item>::capacity();
+
+  // consumer frees everything on its own thread
+  std::jthread([&items] {
+    for (const auto p : items) {
+      slab<item>::yield(p);
+    }
+  }).join();
+
+  // producer gets same slots back instead of growing
+  items.clear();
+  for (size_t i = 0; i < ITEM_COUNT; ++i) {
+    items.push_back(slab<item>::rent(i));
+    EXPECT_TRUE(rented.contains(items.back()));
+  }
+  EXPECT_EQ(slab<item>::capacity(), capacity);
+
+  for (const auto p : items) {
+    slab<item>::yield(p);
+  }
+}
+
+TEST(SlabTest, Limit) {
+  std::vector<item*> items;
+
+  std::jthread([&items] {
+    slab<item>::limit(SLAB_CHUNK_SIZE * 2);
+
+    // beyond limit, objects come from global allocator
+    for (size_t i = 0; i < SLAB_CHUNK_SIZE * 4; ++i) {
+      items.push_back(slab<item>::rent(i));
+    }
+    EXPECT_EQ(slab<item>::capacity(), SLAB_CHUNK_SIZE * 2);
+
+    slab<item>::limit(SLAB_DEFAULT_LIMIT);
+  }).join();
+
+  // heap of exited thread is deleted when its last object comes back
+  for (size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ(items[i]->value, i);
+    slab<item>::yield(items[i]);
+  }
+}
+
+TEST(SlabTest, ProducerConsumer) {
+  static constexpr size_t ITEM_COUNT = 1024 * 256;
+
+  vyukov<item*> channel(1024);
+  size_t capacity = 0;
+
+  std::jthread producer([&channel, &capacity] {
+    for (size_t i = 0; i < ITEM_COUNT; ++i) {
+      channel.blocking_push(slab<item>::rent(i));
+    }
+    capacity = slab<item>::capacity();
+  });
+
+  size_t sum = 0;
+  for (size_t i = 0; i < ITEM_COUNT; ++i) {
+    const auto p = channel.blocking_pop().value();
+    sum += p->value;
+    slab<item>::yield(p);
+  }
+  producer.join();
+
+  EXPECT_EQ(sum, ITEM_COUNT * (ITEM_COUNT - 1) / 2);
+  // bounded by items in flight, not by items produced
+  EXPECT_LE(capacity, 1024 * 4);
+}
+
+TEST(SlabTest, RemoteFreeWhileOwnerAllocates) {
+  static constexpr size_t ROUND_COUNT = 64;
+  static constexpr size_t ITEM_COUNT = 1024 * 16;
+  static constexpr size_t CONSUMER_COUNT = 3;
+
+  for (size_t round = 0; round < ROUND_COUNT; ++round) {
+    // small channel keeps few slots out, so owner keeps collecting what consumers free
+    vyukov<item*> channel(16);
+    std::atomic_size_t sum = 0;
+
+    std::vector<std::jthread> consumers;
+    for (size_t c = 0; c < CONSUMER_COUNT; ++c) {
+      consumers.emplace_back([&channel, &sum] {
+        while (const auto p = channel.blocking_pop()) {
+          sum += p.value()->value;
+          slab<item>::yield(p.value());
+        }
+      });
+    }
+
+    // owner exits while consumers may still be freeing its slots
+    std::jthread([&channel] {
+      for (size_t i = 0; i < ITEM_COUNT; ++i) {
+        const auto local = slab<item>::rent(0);
+        channel.blocking_push(slab<item>::rent(i));
+        slab<item>::yield(local);
+      }
+    }).join();
+
+    while (sum.load() != ITEM_COUNT * (ITEM_COUNT - 1) / 2) {
+      std::this_thread::yield();
+    }
+    channel.kill();
+    consumers.clear();
+  }
+}
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+constexpr size_t TASK_COUNT = 256;
+constexpr size_t ROUND_COUNT = 64;
+
+// --- Test ts::async_mutex and friends ---
+
+static task<> all(scheduler &sch, std::vector<task<>> tasks) {
+  co_await sch.schedule();
+
+  fork_scope scope;
+  for (auto &child : tasks) {
+    co_await scope.spawn(child);
+  }
+  co_await scope.sync();
+
+  for (auto &child : tasks) {
+    co_await child;
+  }
+}
+
+TEST(SyncTest, Mutex) {
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  async_mutex mutex;
+  // plain counter; lock is the only thing keeping increments apart
+  size_t counter = 0;
+
+  auto body = [](scheduler &sch, async_mutex &mutex, size_t &counter) -> task<> {
+    for (size_t i = 0; i < ROUND_COUNT; ++i) {
+      co_await sch.schedule();
+
+      if (i % 2 == 0) {
+        co_await mutex.lock();
+        counter++;
+        mutex.unlock();
+      }
+      else {
+        const auto lock = co_await mutex.scoped_lock();
+        counter++;
+      }
+    }
+  };
+
+  std::vector<task<>> tasks;
+  for (size_t i = 0; i < TASK_COUNT; ++i) {
+    tasks.push_back(body(sch, mutex, counter));
+  }
+  sync_wait(all(sch, std::move(tasks)));
+
+  EXPECT_EQ(counter, TASK_COUNT * ROUND_COUNT);
+  EXPECT_TRUE(mutex.try_lock());
+  mutex.unlock();
+
+  sch.stop(false);
+}
+
+TEST(SyncTest, Semaphore) {
+  static constexpr ptrdiff_t LIMIT = 3;
+
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  async_semaphore semaphore(LIMIT);
+  std::atomic_ptrdiff_t inside = 0;
+  std::atomic_ptrdiff_t peak = 0;
+
+  auto body = [](scheduler &sch, async_semaphore &semaphore, std::atomic_ptrdiff_t &inside,
+    std::atomic_ptrdiff_t &peak) -> task<> {
+    for (size_t i = 0; i < ROUND_COUNT; ++i) {
+      co_await semaphore.acquire();
+
+      const auto now = ++inside;
+      auto seen = peak.load();
+      while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+      }
+
+      // hop while holding unit, so that others pile up
+      co_await sch.schedule();
+      --inside;
+      semaphore.release();
+    }
+  };
+
+  std::vector<task<>> tasks;
+  for (size_t i = 0; i < TASK_COUNT; ++i) {
+    tasks.push_back(body(sch, semaphore, inside, peak));
+  }
+  sync_wait(all(sch, std::move(tasks)));
+
+  EXPECT_LE(peak.load(), LIMIT);
+  EXPECT_EQ(inside.load(), 0);
+  for (ptrdiff_t i = 0; i < LIMIT; ++i) {
+    EXPECT_TRUE(semaphore.try_acquire());
+  }
+  EXPECT_FALSE(semaphore.try_acquire());
+
+  sch.stop(false);
+}
+
+TEST(SyncTest, Latch) {
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  async_latch latch(TASK_COUNT);
+  std::atomic_size_t arrived = 0;
+  std::atomic_size_t early = 0;
+
+  auto waiter = [](scheduler &sch, async_latch &latch, std::atomic_size_t &arrived,
+    std::atomic_size_t &early) -> task<> {
+    co_await sch.schedule();
+    co_await latch;
+    early += arrived.load() != TASK_COUNT;
+  };
+
+  std::vector<task<>> tasks;
+  for (size_t i = 0; i < 16; ++i) {
+    tasks.push_back(waiter(sch, latch, arrived, early));
+  }
+
+  // plain jobs count down; one of them waits for the rest without blocking its worker
+  for (size_t i = 0; i < TASK_COUNT; ++i) {
+    sch.push(job::create([&latch, &arrived, i](size_t) {
+      ++arrived;
+      latch.count_down();
+      if (i == 0) {
+        latch.wait();
+      }
+    }, {}, nullptr));
+  }
+
+  sync_wait(all(sch, std::move(tasks)));
+  latch.wait();
+
+  EXPECT_TRUE(latch.ready());
+  EXPECT_EQ(early.load(), 0);
+
+  sch.stop(false);
+}
+
+TEST(SyncTest, Barrier) {
+  static constexpr size_t PARTY_COUNT = 8;
+
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  async_barrier barrier(PARTY_COUNT);
+  std::array<std::atomic_size_t, ROUND_COUNT> arrived{};
+  std::atomic_size_t torn = 0;
+
+  auto body = [](scheduler &sch, async_barrier &barrier, std::array<std::atomic_size_t, ROUND_COUNT> &arrived,
+    std::atomic_size_t &torn) -> task<> {
+    for (size_t round = 0; round < ROUND_COUNT; ++round) {
+      co_await sch.schedule();
+      ++arrived[round];
+      co_await barrier.arrive_and_wait();
+      // every party of this round is in before anyone leaves it
+      torn += arrived[round].load() != PARTY_COUNT;
+    }
+  };
+
+  std::vector<task<>> tasks;
+  for (size_t i = 0; i < PARTY_COUNT; ++i) {
+    tasks.push_back(body(sch, barrier, arrived, torn));
+  }
+  sync_wait(all(sch, std::move(tasks)));
+
+  EXPECT_EQ(torn.load(), 0);
+
+  sch.stop(false);
+}
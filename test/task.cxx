@@ -0,0 +1,188 @@
+#include <atomic>
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+constexpr size_t CHAIN_LENGTH = 1024 * 16;
+constexpr size_t FAN_OUT = 1024;
+
+// --- Test ts::task ---
+
+static task<int> value(const int v) {
+  co_return v;
+}
+
+static task<int> sum(const int n) {
+  int total = 0;
+  for (int i = 0; i < n; ++i) {
+    total += co_await value(i);
+  }
+  co_return total;
+}
+
+static task<> fail() {
+  throw std::runtime_error("fail");
+  co_return;
+}
+
+static task<uint64_t> fib(const uint32_t n) {
+  if (n < 2) {
+    co_return n;
+  }
+
+  fork_scope scope;
+  auto left = fib(n - 1);
+  co_await scope.spawn(left);
+  const auto right = co_await fib(n - 2);
+  co_await scope.sync();
+
+  co_return co_await left + right;
+}
+
+// leaves hop through scheduler, so children complete on other workers than they were spawned on
+static task<size_t> leaves(scheduler &sch, const uint32_t depth) {
+  if (depth == 0) {
+    co_await sch.schedule();
+    co_return 1;
+  }
+
+  fork_scope scope;
+  auto left = leaves(sch, depth - 1);
+  auto middle = leaves(sch, depth - 1);
+  co_await scope.spawn(left);
+  co_await scope.spawn(middle);
+  const auto right = co_await leaves(sch, depth - 1);
+  co_await scope.sync();
+
+  co_return co_await left + co_await middle + right;
+}
+
+TEST(TaskTest, Lazy) {
+  bool started = false;
+  auto body = [](bool &started) -> task<> {
+    started = true;
+    co_return;
+  };
+
+  auto t = body(started);
+  EXPECT_FALSE(started);
+
+  sync_wait(std::move(t));
+  EXPECT_TRUE(started);
+}
+
+TEST(TaskTest, Value) {
+  EXPECT_EQ(sync_wait(value(42)), 42);
+  EXPECT_EQ(sync_wait(sum(100)), 4950);
+}
+
+TEST(TaskTest, Exception) {
+  EXPECT_THROW(sync_wait(fail()), std::runtime_error);
+}
+
+TEST(TaskTest, SymmetricTransfer) {
+  // each iteration completes synchronously;
+  // without symmetric transfer, stack would overflow
+  auto body = []() -> task<size_t> {
+    size_t total = 0;
+    for (size_t i = 0; i < CHAIN_LENGTH; ++i) {
+      total += co_await value(1);
+    }
+    co_return total;
+  };
+
+  EXPECT_EQ(sync_wait(body()), CHAIN_LENGTH);
+}
+
+TEST(TaskTest, Schedule) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  auto body = [](scheduler &sch) -> task<bool> {
+    co_await sch.schedule();
+    co_return worker::current() != nullptr;
+  };
+
+  EXPECT_FALSE(worker::current());
+  EXPECT_TRUE(sync_wait(body(sch)));
+
+  sch.stop(false);
+}
+
+TEST(TaskTest, FanOut) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t counter = 0;
+
+  auto child = [](scheduler &sch, std::atomic_size_t &counter) -> task<> {
+    co_await sch.schedule();
+    ++counter;
+  };
+
+  auto body = [&child](scheduler &sch, std::atomic_size_t &counter) -> task<size_t> {
+    co_await sch.schedule();
+    for (size_t i = 0; i < FAN_OUT; ++i) {
+      co_await child(sch, counter);
+    }
+    co_return counter.load();
+  };
+
+  EXPECT_EQ(sync_wait(body(sch, counter)), FAN_OUT);
+
+  sch.stop(false);
+}
+
+TEST(TaskTest, ForkJoin) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  auto body = [](scheduler &sch) -> task<uint64_t> {
+    co_await sch.schedule();
+    co_return co_await fib(16);
+  };
+
+  EXPECT_EQ(sync_wait(body(sch)), 987);
+  // off workers, spawn is plain call
+  EXPECT_EQ(sync_wait(fib(12)), 144);
+
+  sch.stop(false);
+}
+
+TEST(TaskTest, ForkJoinMigrating) {
+  scheduler sch({.worker_count = 4});
+  ASSERT_TRUE(sch.start());
+
+  for (size_t round = 0; round < 16; ++round) {
+    auto body = [](scheduler &sch) -> task<size_t> {
+      co_await sch.schedule();
+      co_return co_await leaves(sch, 7);
+    };
+
+    EXPECT_EQ(sync_wait(body(sch)), 2187);
+  }
+
+  sch.stop(false);
+}
+
+TEST(TaskTest, ForkJoinException) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  auto body = [](scheduler &sch) -> task<> {
+    co_await sch.schedule();
+
+    fork_scope scope;
+    auto failing = fail();
+    co_await scope.spawn(failing);
+    co_await scope.sync();
+    co_await failing;
+  };
+
+  EXPECT_THROW(sync_wait(body(sch)), std::runtime_error);
+
+  sch.stop(false);
+}
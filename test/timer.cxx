@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+using namespace std::chrono_literals;
+
+TEST(TimerWheel, FiresInOrder) {
+  timer_wheel wheel;
+  std::vector<timer_wheel::entry> due;
+
+  const std::vector<uint64_t> ticks = {1, 5, 63, 64, 65, 4095, 4096, 4097, 300000, 20000000};
+  for (const auto tick : ticks) {
+    wheel.add({tick, nullptr, nullptr}, due);
+  }
+  ASSERT_TRUE(due.empty());
+  ASSERT_EQ(wheel.size(), ticks.size());
+
+  for (const auto tick : ticks) {
+    const auto next = wheel.next();
+    ASSERT_TRUE(next);
+    EXPECT_LE(*next, tick);
+
+    wheel.advance(tick - 1, due);
+    EXPECT_TRUE(due.empty()) << tick;
+
+    wheel.advance(tick, due);
+    ASSERT_EQ(due.size(), 1) << tick;
+    EXPECT_EQ(due.front().due, tick);
+    due.clear();
+  }
+
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.next());
+}
+
+TEST(TimerWheel, JumpFiresEverythingDue) {
+  timer_wheel wheel;
+  std::vector<timer_wheel::entry> due;
+
+  for (uint64_t tick = 1; tick <= 10000; tick += 7) {
+    wheel.add({tick, nullptr, nullptr}, due);
+  }
+
+  wheel.advance(5000, due);
+  for (const auto &e : due) {
+    EXPECT_LE(e.due, 5000);
+  }
+  EXPECT_EQ(due.size() + wheel.size(), (10000 - 1) / 7 + 1);
+
+  const auto fired = due.size();
+  due.clear();
+  wheel.advance(10000, due);
+  EXPECT_EQ(fired + due.size(), (10000 - 1) / 7 + 1);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(Timer, PushAfter) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  const auto start = timer_clock::now();
+  std::atomic<timer_clock::time_point> fired;
+
+  const auto delayed = job::create([&fired](size_t) { fired = timer_clock::now(); }, {}, nullptr);
+  const auto done = delayed->watch();
+  sch.push_after(20ms, delayed);
+  done.wait();
+
+  EXPECT_GE(fired.load() - start, 20ms);
+  sch.stop(false);
+}
+
+TEST(Timer, OrderOfDeadlines) {
+  scheduler sch({.worker_count = 1});
+  ASSERT_TRUE(sch.start());
+
+  std::mutex mutex;
+  std::vector<int> order;
+  std::vector<handle> handles;
+
+  for (const int i : {3, 1, 2}) {
+    const auto delayed = job::create(
+      [&mutex, &order, i](size_t) {
+        std::lock_guard lock(mutex);
+        order.push_back(i);
+      }, {}, nullptr
+    );
+    handles.push_back(delayed->watch());
+    sch.push_after(i * 10ms, delayed);
+  }
+
+  for (const auto &done : handles) {
+    done.wait();
+  }
+
+  EXPECT_EQ(order, std::vector<int>({1, 2, 3}));
+  sch.stop(false);
+}
+
+TEST(Timer, PushEvery) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t count = 0;
+
+  const auto timer = sch.push_every(
+    2ms, [&count](size_t) {
+      count++;
+      count.notify_one();
+    }
+  );
+
+  for (auto current = count.load(); current < 5; current = count.load()) {
+    count.wait(current);
+  }
+  timer.cancel();
+  EXPECT_TRUE(timer.cancelled());
+
+  // at most one firing already pushed may still run
+  std::this_thread::sleep_for(20ms);
+  const auto stopped = count.load();
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(count.load(), stopped);
+
+  sch.stop(false);
+}
+
+TEST(Timer, PushEveryOutlivesHandle) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_size_t count = 0;
+  {
+    const auto timer = sch.push_every(
+      5ms, [&count](size_t) {
+        count++;
+        count.notify_one();
+      }
+    );
+
+    for (auto current = count.load(); current < 1; current = count.load()) {
+      count.wait(current);
+    }
+    timer.cancel();
+  }
+
+  // entry is still in wheel; it must drop on its own once due
+  std::this_thread::sleep_for(20ms);
+  const auto stopped = count.load();
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(count.load(), stopped);
+
+  sch.stop(false);
+}
+
+TEST(Timer, PushEveryRejectsToken) {
+  scheduler sch({});
+  cancel_source source;
+  EXPECT_THROW(sch.push_every(1ms, [](size_t) {}, {.cancel = source.token()}), std::invalid_argument);
+}
+
+TEST(Timer, FlushRunsPending) {
+  scheduler sch({});
+  ASSERT_TRUE(sch.start());
+
+  std::atomic_bool ran = false;
+  sch.push_after(1h, job::create([&ran](size_t) { ran = true; }, {}, nullptr));
+
+  sch.stop(true);
+  EXPECT_TRUE(ran);
+}
@@ -0,0 +1,66 @@
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+// two packages (one node each) of two cores with two threads; siblings are `i` and `i + 4`
+static topology dual_socket() {
+  std::vector<cpu_info> cpus;
+  for (size_t id = 0; id < 8; ++id) {
+    const size_t package = id % 4 / 2;
+    cpus.push_back({id, package, id % 2, package * 2, package});
+  }
+  return topology(std::move(cpus));
+}
+
+static std::vector<size_t> ids(const topology &topo, const std::vector<size_t> &assigned) {
+  std::vector<size_t> ids;
+  for (const auto i : assigned) {
+    ids.push_back(topo.cpus()[i].id);
+  }
+  return ids;
+}
+
+// --- Test ts::topology ---
+
+TEST(TopologyTest, ParseCpuList) {
+  EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), (std::vector<size_t>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(parse_cpu_list("5"), (std::vector<size_t>{5}));
+  EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(TopologyTest, Distance) {
+  const auto topo = dual_socket();
+  const auto &cpus = topo.cpus();
+
+  EXPECT_EQ(cpus[0].distance(cpus[4]), cpu_distance::smt);
+  EXPECT_EQ(cpus[0].distance(cpus[1]), cpu_distance::l3);
+  EXPECT_EQ(cpus[0].distance(cpus[2]), cpu_distance::remote);
+}
+
+TEST(TopologyTest, Assign) {
+  const auto topo = dual_socket();
+
+  EXPECT_TRUE(topo.assign(pin_policy::none, 8).empty());
+  EXPECT_EQ(ids(topo, topo.assign(pin_policy::compact, 8)), (std::vector<size_t>{0, 4, 1, 5, 2, 6, 3, 7}));
+  EXPECT_EQ(ids(topo, topo.assign(pin_policy::spread, 8)), (std::vector<size_t>{0, 2, 1, 3, 4, 6, 5, 7}));
+
+  // wraps around when workers outnumber cpus
+  EXPECT_EQ(ids(topo, topo.assign(pin_policy::spread, 10)).back(), 2);
+}
+
+TEST(TopologyTest, PinnedScheduler) {
+  for (const auto policy : {pin_policy::compact, pin_policy::spread}) {
+    scheduler sch({.worker_count = 2, .pinning = policy});
+    ASSERT_TRUE(sch.start());
+
+    std::atomic_size_t counter = 0;
+    sch.submit(job::create([&counter](size_t) { ++counter; }, {0, 4096, 16}, nullptr)).wait();
+    EXPECT_EQ(counter.load(), 4096);
+
+    sch.stop(false);
+  }
+}
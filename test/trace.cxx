@@ -0,0 +1,45 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "ts/ts.h"
+
+using namespace ts;
+
+// --- Test ts::trace_ring ---
+
+TEST(TraceTest, RingKeepsNewest) {
+  trace_ring ring(8);
+  for (uint32_t i = 0; i < 20; ++i) {
+    ring.record(trace_event::split, i);
+  }
+
+  uint32_t expected = 12;
+  ring.for_each([&expected](const trace_record &record) {
+    EXPECT_EQ(record.event, trace_event::split);
+    EXPECT_EQ(record.arg, expected++);
+  });
+  EXPECT_EQ(expected, 20);
+}
+
+TEST(TraceTest, ChromeExport) {
+  scheduler sch({.worker_count = 2});
+  ASSERT_TRUE(sch.start());
+
+  sch.submit(job::create([](size_t) {}, {0, 1024, 8}, nullptr)).wait();
+  sch.stop(false);
+
+  std::ostringstream out;
+  sch.write_trace(out);
+  const auto text = out.str();
+
+  EXPECT_TRUE(text.starts_with(R"({"displayTimeUnit":"ns","traceEvents":[)"));
+  EXPECT_NE(text.find(R"("args":{"name":"worker 1"})"), std::string::npos);
+  if constexpr (TRACE_ENABLED) {
+    EXPECT_NE(text.find(R"({"name":"job","ph":"B")"), std::string::npos);
+    EXPECT_NE(text.find(R"({"name":"split","ph":"i")"), std::string::npos);
+  }
+  else {
+    EXPECT_EQ(text.find(R"("name":"job")"), std::string::npos);
+  }
+}
@@ -16,10 +16,11 @@ constexpr size_t BASE_ITEM_COUNT = 1024 * 16;
 
 TEST(WorkerTest, BasicDispatch) {
   std::vector<std::unique_ptr<worker>> workers{};
-  vyukov<job*> global(4096);
+  injector global(4096);
+  eventcount idle;
 
   workers.reserve(1);
-  workers.emplace_back(std::make_unique<worker>(workers, global, 4096));
+  workers.emplace_back(std::make_unique<worker>(workers, global, idle, 4096));
 
   workers[0]->start();
 
@@ -28,6 +29,7 @@ TEST(WorkerTest, BasicDispatch) {
   ASSERT_TRUE(
     global.push(job::create([&done] (size_t) { done.test_and_set(); }, {}, nullptr))
   );
+  idle.notify_one();
 
   while (!done.test()) {
     _mm_pause();
@@ -44,12 +46,13 @@ TEST(WorkerTest, GrainedIntegrity) {
   std::atomic_size_t counter = 0;
   std::atomic_flag alarm = ATOMIC_FLAG_INIT;
 
-  vyukov<job*> global(4096);
+  injector global(4096);
+  eventcount idle;
 
   // prepare workers
   workers.reserve(THREAD_COUNT);
   for (size_t i = 0; i < THREAD_COUNT; ++i) {
-    workers.emplace_back(std::make_unique<worker>(workers, global, 4096));
+    workers.emplace_back(std::make_unique<worker>(workers, global, idle, 4096));
   }
   for (size_t i = 0; i < THREAD_COUNT; ++i) {
     workers[i]->start();
@@ -72,6 +75,7 @@ TEST(WorkerTest, GrainedIntegrity) {
             std::cout << current << '/' << BASE_ITEM_COUNT << std::endl;
           }
         }, {}, nullptr));
+    idle.notify_one();
   }
 
   // waiting for completion
@@ -110,12 +114,13 @@ TEST(WorkerTest, CoarsedIntegrity) {
   std::atomic_size_t counter = 0;
   std::atomic_flag alarm = ATOMIC_FLAG_INIT;
 
-  vyukov<job*> global(4096);
+  injector global(4096);
+  eventcount idle;
 
   // prepare workers
   workers.reserve(THREAD_COUNT);
   for (size_t i = 0; i < THREAD_COUNT; ++i) {
-    workers.emplace_back(std::make_unique<worker>(workers, global, 4096));
+    workers.emplace_back(std::make_unique<worker>(workers, global, idle, 4096));
   }
   for (size_t i = 0; i < THREAD_COUNT; ++i) {
     workers[i]->start();
@@ -137,6 +142,7 @@ TEST(WorkerTest, CoarsedIntegrity) {
         }
       }, { 0, BASE_ITEM_COUNT }, nullptr)
   );
+  idle.notify_one();
 
   // waiting for completion
   do {